@@ -346,12 +346,42 @@ public:
 
         app.add_option("--cpu-devices,--cp-devices", m_CPSettings.devices, "");
 
+        app.add_option("--cpu-dag-threads,--cp-dag-threads", m_CPSettings.dagThreads, "", true)
+            ->check(CLI::Range(0, 1024));
+
+        app.add_option("--cpu-huge-pages,--cp-huge-pages", m_CPSettings.hugePages, "", true)
+            ->check(CLI::Range(0, 3));
+
 #endif
 
         app.add_flag("--noeval", m_FarmSettings.noEval, "");
 
+        app.add_option("--verify-threads", m_FarmSettings.verifyThreads, "", true)
+            ->check(CLI::Range(1, 64));
+
+        app.add_option("--verify-queue", m_FarmSettings.verifyQueue, "", true)
+            ->check(CLI::Range(1, 4096));
+
         app.add_option("-L,--dag-load-mode", m_FarmSettings.dagLoadMode, "", true)->check(CLI::Range(1));
 
+#if defined(__linux__) || defined(__APPLE__)
+        if (const char* xdg = getenv("XDG_CACHE_HOME"))
+            m_FarmSettings.dagCache = std::string(xdg) + "/ethcoreminer/dag";
+        else if (const char* home = getenv("HOME"))
+            m_FarmSettings.dagCache = std::string(home) + "/.cache/ethcoreminer/dag";
+#endif
+        app.add_option("--dag-cache", m_FarmSettings.dagCache, "", true);
+
+        app.add_option("--dag-prebuild", m_FarmSettings.dagPrebuild, "", true);
+
+        app.add_option("--epoch-cache-light", m_FarmSettings.epochCacheLight, "", true)
+            ->check(CLI::Range(1, 99));
+
+        app.add_option("--epoch-cache-full", m_FarmSettings.epochCacheFull, "", true)
+            ->check(CLI::Range(1, 99));
+
+        app.add_option("--epoch-cache-mem", m_FarmSettings.epochCacheMemory, "", true);
+
         bool cl_miner = false;
         app.add_flag("-G,--opencl", cl_miner, "");
 
@@ -465,6 +495,9 @@ public:
             m_CUSettings.schedule = 4;
 #endif
 
+        if (m_FarmSettings.dagCache == "none")
+            m_FarmSettings.dagCache.clear();
+
         if (m_FarmSettings.tempStop)
         {
             // If temp threshold set HWMON at least to 1
@@ -950,6 +983,22 @@ public:
                  << "                        Space separated list of device indexes to use" << endl
                  << "                        eg --cp-devices 0 2 3" << endl
                  << "                        If not set all available CPUs will be used" << endl
+                 << "    --cp-dag-threads    UINT [0 .. 1024] Default = " << m_CPSettings.dagThreads << endl
+                 << "                        Number of threads generating the DAG on epoch change"
+                 << endl
+                 << "                        0 uses all available CPUs" << endl
+                 << "    --cp-huge-pages     UINT [0 .. 3] Default = " << m_CPSettings.hugePages << endl
+                 << "                        Largest pages tried for the DAG, falling back to the"
+                 << endl
+                 << "                        next ones when not available. Can be one of:" << endl
+                 << "                        0 Normal pages" << endl
+                 << "                        1 Transparent huge pages" << endl
+                 << "                        2 2 MB huge pages (reserved in /proc/sys/vm/nr_hugepages)"
+                 << endl
+                 << "                        3 1 GB huge pages (reserved with the hugepages= kernel"
+                 << endl
+                 << "                          parameter)" << endl
+                 << "                        Compare them with -M" << endl
                  << endl;
         }
 
@@ -1013,6 +1062,14 @@ public:
                  << "                        found nonces. Trims some ms. from submission" << endl
                  << "                        time but it may increase rejected solution rate."
                  << endl
+                 << "    --verify-threads    UINT[1 .. 64] Default = " << m_FarmSettings.verifyThreads
+                 << endl
+                 << "                        Threads re-evaluating the found nonces" << endl
+                 << "    --verify-queue      UINT[1 .. 4096] Default = " << m_FarmSettings.verifyQueue
+                 << endl
+                 << "                        Found nonces waiting for re-evaluation at most. Beyond"
+                 << endl
+                 << "                        the device thread re-evaluates them itself" << endl
                  << "    --list-devices      FLAG Lists the detected OpenCL/CUDA devices and "
                     "exits"
                  << endl
@@ -1021,6 +1078,33 @@ public:
                  << "                        Set DAG load mode. Can be one of:" << endl
                  << "                        0 Parallel load mode (each GPU independently)" << endl
                  << "                        1 Sequential load mode (one GPU after another)" << endl
+                 << "    --dag-cache         TEXT Default = " << m_FarmSettings.dagCache << endl
+                 << "                        Directory keeping the generated light caches and DAGs"
+                 << endl
+                 << "                        which are mapped instead of regenerated on restart"
+                 << endl
+                 << "                        Use none to disable" << endl
+                 << "    --dag-prebuild      UINT Default = " << m_FarmSettings.dagPrebuild << endl
+                 << "                        Memory in MB the light caches and DAGs of the current"
+                 << endl
+                 << "                        and the next epoch may take together. When they fit,"
+                 << endl
+                 << "                        the next ones are built in the background near the"
+                 << endl
+                 << "                        epoch boundary. 0 disables" << endl
+                 << "    --epoch-cache-light UINT[1 .. 99] Default = "
+                 << m_FarmSettings.epochCacheLight << endl
+                 << "                        Light caches of the recent epochs kept in memory, so"
+                 << endl
+                 << "                        switching pools between epochs does not rebuild them"
+                 << endl
+                 << "    --epoch-cache-full  UINT[1 .. 99] Default = "
+                 << m_FarmSettings.epochCacheFull << endl
+                 << "                        Same for the CPU miner DAGs, per NUMA node" << endl
+                 << "    --epoch-cache-mem   UINT Default = " << m_FarmSettings.epochCacheMemory << endl
+                 << "                        Memory in MB the kept light caches and DAGs may take"
+                 << endl
+                 << "                        0 means no limit" << endl
                  << endl
                  << "    --tstart            UINT[30 .. 100] Default = 0" << endl
                  << "                        Suspend mining on GPU which temperature is above"
@@ -1043,6 +1127,7 @@ public:
                  << "                        64  to log time for job switches" << endl
                  << "                        128 to log time for solution submissions" << endl
                  << "                        256 to log kernel compile diagnostics" << endl
+                 << "                        512 to log program flow" << endl
 #endif
                  << endl;
         }
@@ -1240,6 +1240,28 @@ Json::Value ApiConnection::getMinerStatDetail()
     mininginfo["epoch_changes"] = PoolManager::p().getEpochChanges();
     mininginfo["difficulty"] = PoolManager::p().getCurrentDifficulty();
 
+    ethash::epoch_cache_stats cache = ethash::get_epoch_cache_stats();
+    Json::Value cacheinfo;
+    cacheinfo["light"] = cache.light_contexts;
+    cacheinfo["full"] = cache.full_contexts;
+    cacheinfo["bytes"] = cache.bytes;
+    cacheinfo["hits"] = cache.hits;
+    cacheinfo["misses"] = cache.misses;
+    cacheinfo["evictions"] = cache.evictions;
+    mininginfo["epoch_cache"] = cacheinfo;
+
+    VerifierStats verifier = Farm::f().getVerifierStats();
+    Json::Value verifierinfo;
+    verifierinfo["queue"] = verifier.queueDepth;
+    verifierinfo["max_queue"] = verifier.maxQueueDepth;
+    verifierinfo["verified"] = verifier.verified;
+    verifierinfo["inlined"] = verifier.inlined;
+    Json::Value latencyinfo = Json::Value(Json::arrayValue);
+    for (uint64_t count : verifier.latency)
+        latencyinfo.append(count);
+    verifierinfo["latency"] = latencyinfo;
+    mininginfo["verification"] = verifierinfo;
+
     sharesinfo.append(t.farm.solutions.accepted);
     sharesinfo.append(t.farm.solutions.rejected);
     sharesinfo.append(t.farm.solutions.failed);
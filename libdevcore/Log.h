@@ -42,7 +42,18 @@
 #define LOG_SWITCH 64
 #define LOG_SUBMIT 128
 #define LOG_COMPILE 256
-#define LOG_NEXT 512
+#define LOG_PROGRAMFLOW 512
+#define LOG_NEXT 1024
+#endif
+
+#ifdef DEV_BUILD
+#define DEV_BUILD_LOG_PROGRAMFLOW(_S, _V) \
+    if (g_logOptions & LOG_PROGRAMFLOW)   \
+    {                                     \
+        _S << _V;                         \
+    }
+#else
+#define DEV_BUILD_LOG_PROGRAMFLOW(_S, _V)
 #endif
 
 extern unsigned g_logOptions;
@@ -24,22 +24,27 @@ along with ethcoreminer.  If not, see <http://www.gnu.org/licenses/>.
 #if !defined(_GNU_SOURCE)
 #define _GNU_SOURCE /* we need sched_setaffinity() */
 #endif
+#include <dirent.h>
+#include <dlfcn.h>
 #include <error.h>
 #include <sched.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
 #include <libethcore/Farm.h>
+#include <libprogpow/ProgPow.h>
 #include <ethash/ethash.hpp>
+#include <ethash/progpow.hpp>
 
 #include <boost/version.hpp>
 
-#if 0
-#include <boost/fiber/numa/pin_thread.hpp>
-#include <boost/fiber/numa/topology.hpp>
-#endif
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 
 #include "CPUMiner.h"
+#include "CPUMiner_kernel.h"
 
 
 /* Sanity check for defined OS */
@@ -103,18 +108,7 @@ static size_t getTotalPhysAvailableMemory()
  */
 unsigned CPUMiner::getNumDevices()
 {
-#if 0
-    static unsigned cpus = 0;
-
-    if (cpus == 0)
-    {
-        std::vector< boost::fibers::numa::node > topo = boost::fibers::numa::topology();
-        for (auto n : topo) {
-            cpus += n.logical_cpus.size();
-        }
-    }
-    return cpus;
-#elif defined(__APPLE__) || defined(__MACOSX)
+#if defined(__APPLE__) || defined(__MACOSX)
 #error "TODO: Function CPUMiner::getNumDevices() on MAXOSX not implemented"
 #elif defined(__linux__)
     long cpus_available;
@@ -133,6 +127,76 @@ unsigned CPUMiner::getNumDevices()
 #endif
 }
 
+/*
+ * returns the logical CPUs of each NUMA node, indexed by node number
+ *
+ * Without NUMA information all CPUs are on node 0.
+ */
+static const std::vector<std::vector<unsigned>>& getNumaNodes()
+{
+    static const std::vector<std::vector<unsigned>> nodes = [] {
+        std::vector<std::vector<unsigned>> nodes;
+#if defined(__linux__)
+        if (DIR* dir = opendir("/sys/devices/system/node"))
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                unsigned node;
+                char tail;
+                if (sscanf(entry->d_name, "node%u%c", &node, &tail) != 1)
+                    continue;
+
+                // The list is formatted as "0-3,8-11"
+                std::ifstream list(
+                    std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+                std::vector<unsigned> cpus;
+                unsigned first, last;
+                while (list >> first)
+                {
+                    last = first;
+                    if (list.peek() == '-')
+                        list.ignore() >> last;
+                    for (unsigned cpu = first; cpu <= last; cpu++)
+                        cpus.push_back(cpu);
+                    if (list.peek() == ',')
+                        list.ignore();
+                }
+                if (cpus.empty())
+                    continue;  // Memory only node
+
+                if (nodes.size() <= node)
+                    nodes.resize(node + 1);
+                nodes[node] = std::move(cpus);
+            }
+            closedir(dir);
+        }
+#endif
+        if (nodes.empty())
+        {
+            nodes.emplace_back();
+            for (unsigned cpu = 0; cpu < CPUMiner::getNumDevices(); cpu++)
+                nodes[0].push_back(cpu);
+        }
+        return nodes;
+    }();
+    return nodes;
+}
+
+#if defined(__linux__)
+/*
+ * Bind the current thread to the given CPUs
+ */
+static bool setThreadAffinity(const std::vector<unsigned>& cpus)
+{
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (unsigned cpu : cpus)
+        CPU_SET(cpu, &cpuset);
+    return sched_setaffinity(0, sizeof(cpuset), &cpuset) == 0;
+}
+#endif
+
+
 
 /* ######################## CPU Miner ######################## */
 
@@ -168,6 +232,7 @@ bool CPUMiner::initDevice()
     DEV_BUILD_LOG_PROGRAMFLOW(cpulog, "cp-" << m_index << " CPUMiner::initDevice begin");
 
     cpulog << "Using CPU: " << m_deviceDescriptor.cpCpuNumer << " " << m_deviceDescriptor.cuName
+           << " NUMA node: " << m_deviceDescriptor.cpNumaNode
            << " Memory : " << dev::getFormattedMemory((double)m_deviceDescriptor.totalMemory);
 
 #if defined(__APPLE__) || defined(__MACOSX)
@@ -212,10 +277,172 @@ bool CPUMiner::initDevice()
  */
 bool CPUMiner::initEpoch_internal()
 {
+    // Generate the whole DAG upfront so hashing runs at full speed right away
+    // instead of filling the DAG lazily at light cache speed.
+    // Only the first miner getting here builds it, the others wait for the result.
+    auto startInit = std::chrono::steady_clock::now();
+
+    // Random DAG reads miss the TLB less with huge pages.
+    ethash::set_max_memory_mode(static_cast<ethash::memory_mode>(m_settings.hugePages));
+
+    // Each NUMA node gets its own replica of the DAG, so no thread reads remote memory.
+    // The replica is built on the CPUs of the node: the build threads inherit the affinity
+    // and the pages are placed on the node that touches them first.
+    const unsigned node = m_deviceDescriptor.cpNumaNode;
+    const auto& nodeCpus = getNumaNodes()[node];
+    const bool numa = getNumaNodes().size() > 1;
+
+    ethash::build_options options;
+    options.num_threads = m_settings.dagThreads;
+    if (numa && options.num_threads == 0)
+        options.num_threads = nodeCpus.size();
+    options.cancel = &m_dag_cancel;
+
+    int lastPercent = -1;
+    options.progress = [this, &lastPercent](int done, int total) {
+        int percent = int(uint64_t(done) * 100 / uint64_t(total));
+        if (percent / 10 == lastPercent / 10)
+            return;
+        lastPercent = percent;
+        cpulog << "cp-" << m_index << " Generating DAG " << percent << "%";
+    };
+
+#if defined(__linux__)
+    if (numa)
+        setThreadAffinity(nodeCpus);
+#endif
+
+    const auto& context =
+        ethash::get_numa_epoch_context_full(m_epochContext.epochNumber, node, options);
+
+#if defined(__linux__)
+    if (numa && !setThreadAffinity({unsigned(m_deviceDescriptor.cpCpuNumer)}))
+        cwarn << "cp-" << m_index << " could not bind thread back to cpu "
+              << m_deviceDescriptor.cpCpuNumer;
+#endif
+
+    if (shouldStop())
+        return false;
+
+    cpulog << "cp-" << m_index << " DAG ready for epoch " << m_epochContext.epochNumber << " ("
+           << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - startInit)
+                  .count()
+           << " ms, " << ethash::to_string(ethash::get_memory_mode(context))
+           << (numa ? ", NUMA node " + std::to_string(node) : "") << ")";
     return true;
 }
 
 
+/*
+ * Compiles the ProgPoW kernel of the period with the system compiler into a shared object
+ * and registers it for all ProgPoW hashing in the process.
+ *
+ * The shared objects are cached in $XDG_CACHE_HOME/ethcoreminer/progpow (or ~/.cache/...)
+ * named after the period and the kernel source, so the compilation happens once per period.
+ * The compiler is $CC or cc. On failure the built-in ProgPoW implementation is used.
+ */
+bool CPUMiner::compileKernel(uint64_t period_seed)
+{
+#if defined(__linux__)
+    static std::mutex x_compile;
+    static uint64_t compiledPeriod = -1;
+
+    std::lock_guard<std::mutex> l(x_compile);
+    if (compiledPeriod == period_seed)
+        return true;
+
+    std::string text = ProgPow::getKern(CPUMiner_kernel, period_seed, ProgPow::KERNEL_CPU);
+
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (!cacheHome && !home)
+    {
+        cwarn << "cp-" << m_index << " No cache directory for the ProgPoW kernel";
+        return false;
+    }
+    std::string dir = cacheHome ? std::string(cacheHome) : std::string(home) + "/.cache";
+    for (const char* sub : {"/ethcoreminer", "/progpow"})
+    {
+        dir.append(sub);
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            cwarn << "cp-" << m_index << " Unable to create " << dir << " \"" << strerror(errno)
+                  << "\"";
+            return false;
+        }
+    }
+
+    std::ostringstream base;
+    base << dir << "/kernel-" << period_seed << "-" << std::hex << std::hash<std::string>()(text);
+    const std::string soFile = base.str() + ".so";
+
+    if (access(soFile.c_str(), R_OK) != 0)
+    {
+        const std::string srcFile = base.str() + ".c";
+        const std::string tmpFile = base.str() + ".so." + std::to_string(getpid());
+        std::ofstream write(srcFile);
+        write << text;
+        write.close();
+        if (!write)
+        {
+            cwarn << "cp-" << m_index << " Unable to write " << srcFile;
+            return false;
+        }
+
+        const char* cc = getenv("CC");
+        std::string cmd = std::string(cc ? cc : "cc") +
+                          " -std=gnu99 -O3 -march=native -shared -fPIC -o '" + tmpFile + "' '" +
+                          srcFile + "' 2>&1";
+        DEV_BUILD_LOG_PROGRAMFLOW(cpulog, "cp-" << m_index << " " << cmd);
+
+        auto startCompile = std::chrono::steady_clock::now();
+        std::string output;
+        FILE* pipe = popen(cmd.c_str(), "r");
+        if (!pipe)
+        {
+            cwarn << "cp-" << m_index << " Unable to run the compiler \"" << strerror(errno)
+                  << "\"";
+            return false;
+        }
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), pipe))
+            output.append(buffer);
+        if (pclose(pipe) != 0 || rename(tmpFile.c_str(), soFile.c_str()) != 0)
+        {
+            cwarn << "cp-" << m_index << " ProgPoW kernel compilation failed: " << output;
+            unlink(tmpFile.c_str());
+            return false;
+        }
+        cpulog << "cp-" << m_index << " Compiled period " << period_seed << " ProgPoW kernel ("
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - startCompile)
+                      .count()
+               << " ms.)";
+    }
+
+    // The library stays loaded: the rounds must remain callable once registered.
+    void* handle = dlopen(soFile.c_str(), RTLD_NOW | RTLD_LOCAL);
+    auto rounds = handle ? reinterpret_cast<progpow::native_rounds_fn>(
+                               dlsym(handle, "progpow_rounds")) :
+                           nullptr;
+    if (!rounds)
+    {
+        cwarn << "cp-" << m_index << " Unable to load " << soFile << " \"" << dlerror() << "\"";
+        return false;
+    }
+
+    progpow::set_native_rounds(period_seed, rounds);
+    compiledPeriod = period_seed;
+    cpulog << "cp-" << m_index << " Loaded period " << period_seed << " ProgPoW kernel";
+    return true;
+#else
+    (void)period_seed;
+    return false;
+#endif
+}
+
+
 /*
    Miner should stop working on the current block
    This happens if a
@@ -225,6 +452,10 @@ bool CPUMiner::initEpoch_internal()
 */
 void CPUMiner::kick_miner()
 {
+    // Abort a DAG generation in progress only if the miner is stopping.
+    if (shouldStop())
+        m_dag_cancel.store(true, std::memory_order_relaxed);
+
     m_new_work.store(true, std::memory_order_relaxed);
     m_new_work_signal.notify_one();
 }
@@ -317,6 +548,16 @@ void CPUMiner::workLoop()
             // Start searching
             search(w);
         }
+        else if (w.algo == "progpow")
+        {
+            // Have the period's kernel ready for the ProgPoW hashing in the process
+            int period_seed = w.block / PROGPOW_PERIOD;
+            if (current.algo != w.algo || current.block / PROGPOW_PERIOD != period_seed)
+                compileKernel(uint64_t(period_seed));
+            current = w;
+
+            throw std::runtime_error("Algo : " + w.algo + " not yet implemented");
+        }
         else
         {
             throw std::runtime_error("Algo : " + w.algo + " not yet implemented");
@@ -354,6 +595,11 @@ void CPUMiner::enumDevices(std::map<string, DeviceDescriptor>& _DevicesCollectio
         deviceDescriptor.totalMemory = getTotalPhysAvailableMemory();
 
         deviceDescriptor.cpCpuNumer = i;
+        deviceDescriptor.cpNumaNode = 0;
+        const auto& nodes = getNumaNodes();
+        for (unsigned node = 0; node < nodes.size(); node++)
+            if (std::find(nodes[node].begin(), nodes[node].end(), i) != nodes[node].end())
+                deviceDescriptor.cpNumaNode = node;
 
         _DevicesCollection[uniqueId] = deviceDescriptor;
     }
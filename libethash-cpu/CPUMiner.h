@@ -45,7 +45,9 @@ protected:
 
 private:
     atomic<bool> m_new_work = {false};
+    atomic<bool> m_dag_cancel = {false};
     void workLoop() override;
+    bool compileKernel(uint64_t period_seed);
     CPSettings m_settings;
 };
 
@@ -0,0 +1,38 @@
+PROGPOW_REPLACE_HEADER
+
+#include <string.h>
+
+// Loads the 2048-bit dataset item `index` as 64 words
+typedef void (*progpow_lookup_t)(const void* context, uint32_t index, uint32_t* item);
+
+// Runs all the loops of the period's program on the mix of all lanes.
+// The mix is in the [register][lane] layout, so every register maps onto one lanes_t.
+void progpow_rounds(
+    uint32_t mixes[PROGPOW_REGS][PROGPOW_LANES],
+    const uint32_t* c_dag,
+    uint32_t dag_elements,
+    progpow_lookup_t lookup,
+    const void* context
+    )
+{
+    // The caller's mix is not necessarily aligned for the vectors
+    lanes_t mix[PROGPOW_REGS];
+    memcpy(mix, mixes, sizeof(mix));
+
+    for (uint32_t loop = 0; loop < PROGPOW_CNT_DAG; loop++)
+    {
+        uint32_t item[PROGPOW_LANES * PROGPOW_DAG_LOADS];
+        lookup(context, mix[0][loop % PROGPOW_LANES] % dag_elements, item);
+
+        // The lane l consumes the words from ((l ^ loop) % PROGPOW_LANES) * PROGPOW_DAG_LOADS
+        dag_t data_dag;
+        for (int i = 0; i < PROGPOW_DAG_LOADS; i++)
+            for (uint32_t lane_id = 0; lane_id < PROGPOW_LANES; lane_id++)
+                data_dag.s[i][lane_id] =
+                    item[((lane_id ^ loop) % PROGPOW_LANES) * PROGPOW_DAG_LOADS + i];
+
+        PROGPOW_REPLACE_MATH
+    }
+
+    memcpy(mixes, mix, sizeof(mix));
+}
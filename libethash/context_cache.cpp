@@ -0,0 +1,350 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+/// @file
+/// The on-disk cache of the epoch contexts.
+///
+/// A cache file is the image of the context allocation: a 64-byte header in place of the context
+/// object followed by the light cache and then either the ProgPoW L1 cache (light contexts) or
+/// the full dataset (full contexts). When the context can get huge pages the file is read into
+/// them, otherwise loading maps the file privately over an anonymous mapping of the whole
+/// allocation, so the data is paged in from the file and never copied.
+
+#include "ethash-internal.hpp"
+
+#include <ethash/progpow.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ETHASH_CONTEXT_CACHE 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define ETHASH_CONTEXT_CACHE 0
+#endif
+
+namespace ethash
+{
+namespace
+{
+/// Bump when the layout of the files changes, the files of other versions are ignored.
+/// Being written in the native byte order, the version also rejects files from other-endian hosts.
+constexpr uint32_t file_format_version = 1;
+
+constexpr char file_magic[8] = {'E', 'T', 'H', 'C', 'T', 'X', '\0', '\0'};
+
+struct file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t full;
+    int32_t epoch_number;
+    int32_t light_cache_num_items;
+    int32_t full_dataset_num_items;
+    uint32_t reserved0;
+    uint64_t payload_size;
+    uint64_t checksum;
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(file_header) == sizeof(hash512), "the header takes the place of the context");
+
+std::mutex cache_directory_mutex;
+std::string cache_directory;
+
+/// The size of everything following the header: the light cache and the L1 cache or
+/// the full dataset.
+size_t payload_size(const epoch_context& context, bool full) noexcept
+{
+    return get_light_cache_size(context.light_cache_num_items) +
+           (full ? static_cast<size_t>(get_full_dataset_size(context.full_dataset_num_items)) :
+                   progpow::l1_cache_size);
+}
+
+/// Four interleaved FNV-1a lanes over 64-bit words, so the multiplications of the lanes overlap.
+/// The size must be a multiple of 32 bytes.
+uint64_t checksum(const void* data, size_t size) noexcept
+{
+    static constexpr uint64_t prime = 0x100000001b3;
+    static constexpr uint64_t offset_basis = 0xcbf29ce484222325;
+
+    const auto* words = static_cast<const uint64_t*>(data);
+    const size_t num_words = size / sizeof(uint64_t);
+
+    uint64_t h[4] = {offset_basis, offset_basis + 1, offset_basis + 2, offset_basis + 3};
+    for (size_t i = 0; i < num_words; i += 4)
+    {
+        for (size_t j = 0; j < 4; ++j)
+            h[j] = (h[j] ^ words[i + j]) * prime;
+    }
+
+    uint64_t r = offset_basis;
+    for (auto x : h)
+        r = (r ^ x) * prime;
+    return r;
+}
+
+std::string get_cache_directory()
+{
+    std::lock_guard<std::mutex> lock{cache_directory_mutex};
+    return cache_directory;
+}
+
+std::string file_path(const std::string& directory, int epoch_number, bool full)
+{
+    return directory + (full ? "/full-" : "/light-") + std::to_string(epoch_number) + ".ethash";
+}
+
+#if ETHASH_CONTEXT_CACHE
+
+bool read_all(int fd, void* data, size_t size) noexcept
+{
+    char* p = static_cast<char*>(data);
+    off_t offset = 0;
+    while (size > 0)
+    {
+        const ssize_t n = ::pread(fd, p, std::min(size, size_t{1} << 30), offset);
+        if (n <= 0)
+            return false;
+        p += n;
+        offset += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool write_all(int fd, const void* data, size_t size) noexcept
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = ::write(fd, p, std::min(size, size_t{1} << 30));
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/// Writes the context into the cache directory. The file appears under its final name only
+/// once complete.
+void write_file(const std::string& directory, const epoch_context& context, bool full) noexcept
+{
+    const size_t size = payload_size(context, full);
+    const void* payload = context.light_cache;
+
+    file_header header{};
+    std::copy(std::begin(file_magic), std::end(file_magic), header.magic);
+    header.version = file_format_version;
+    header.full = full;
+    header.epoch_number = context.epoch_number;
+    header.light_cache_num_items = context.light_cache_num_items;
+    header.full_dataset_num_items = context.full_dataset_num_items;
+    header.payload_size = size;
+    header.checksum = checksum(payload, size);
+
+    const std::string path = file_path(directory, context.epoch_number, full);
+    const std::string tmp_path = path + ".tmp";
+
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+
+    const bool ok = write_all(fd, &header, sizeof(header)) && write_all(fd, payload, size);
+    if (::close(fd) != 0 || !ok || ::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        ::unlink(tmp_path.c_str());
+        return;
+    }
+
+    // Keep the files of the last two epochs only.
+    if (context.epoch_number >= 2)
+        ::unlink(file_path(directory, context.epoch_number - 2, full).c_str());
+}
+
+/// Maps the file privately over an anonymous mapping of the whole allocation.
+void* map_image(int fd, size_t file_size, size_t alloc_size) noexcept
+{
+    void* p =
+        ::mmap(nullptr, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return nullptr;
+
+    if (::mmap(p, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        ::munmap(p, alloc_size);
+        return nullptr;
+    }
+
+    register_context_memory(p, alloc_size, memory_mode::file_mapping);
+    return p;
+}
+
+epoch_context_full* map_file(int epoch_number, bool full) noexcept
+{
+    const std::string directory = get_cache_directory();
+    if (directory.empty())
+        return nullptr;
+
+    const std::string path = file_path(directory, epoch_number, full);
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    const int light_cache_num_items = calculate_light_cache_num_items(epoch_number);
+    const int full_dataset_num_items = calculate_full_dataset_num_items(epoch_number);
+    const size_t light_cache_size = get_light_cache_size(light_cache_num_items);
+    const size_t size = light_cache_size +
+                        (full ? static_cast<size_t>(get_full_dataset_size(full_dataset_num_items)) :
+                                progpow::l1_cache_size);
+    const size_t file_size = sizeof(file_header) + size;
+
+    // The bitmaps of the full dataset follow the file image.
+    const size_t bitmap_num_words =
+        full ? (static_cast<size_t>(full_dataset_num_items) + 63) / 64 : 0;
+    const size_t bitmap_size = bitmap_num_words * sizeof(std::atomic<uint64_t>);
+    const size_t alloc_size = file_size + 2 * bitmap_size;
+
+    file_header header{};
+    struct stat st = {};
+    const bool valid =
+        ::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == file_size &&
+        ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+        std::equal(std::begin(file_magic), std::end(file_magic), header.magic) &&
+        header.version == file_format_version && header.full == uint32_t{full} &&
+        header.epoch_number == epoch_number &&
+        header.light_cache_num_items == light_cache_num_items &&
+        header.full_dataset_num_items == full_dataset_num_items && header.payload_size == size;
+
+    void* base = nullptr;
+    if (valid)
+    {
+        // Huge pages save more on the hashing than the copy costs once.
+        memory_mode mode;
+        base = allocate_context_memory(alloc_size, mode);
+        if (base && mode == memory_mode::normal_pages)
+        {
+            free_context_memory(base);
+            base = map_image(fd, file_size, alloc_size);
+        }
+        else if (base && !read_all(fd, base, file_size))
+        {
+            free_context_memory(base);
+            base = nullptr;
+        }
+    }
+    ::close(fd);
+
+    if (!base)
+        return nullptr;
+
+    char* const alloc_data = static_cast<char*>(base);
+    if (checksum(alloc_data + sizeof(file_header), size) != header.checksum)
+    {
+        // Corrupted, let it be regenerated and written again.
+        free_context_memory(base);
+        ::unlink(path.c_str());
+        return nullptr;
+    }
+
+    auto* const light_cache = reinterpret_cast<hash512*>(alloc_data + sizeof(file_header));
+    auto* const l1_cache = reinterpret_cast<uint32_t*>(alloc_data + sizeof(file_header) + light_cache_size);
+
+    hash1024* full_dataset = nullptr;
+    std::atomic<uint64_t>* full_dataset_claimed = nullptr;
+    std::atomic<uint64_t>* full_dataset_ready = nullptr;
+    if (full)
+    {
+        // The dataset in the file is complete.
+        full_dataset = reinterpret_cast<hash1024*>(l1_cache);
+        full_dataset_claimed = reinterpret_cast<std::atomic<uint64_t>*>(alloc_data + file_size);
+        full_dataset_ready = full_dataset_claimed + bitmap_num_words;
+        for (size_t i = 0; i < 2 * bitmap_num_words; ++i)
+            new (&full_dataset_claimed[i]) std::atomic<uint64_t>{~uint64_t{0}};
+    }
+
+    return new (alloc_data) epoch_context_full{
+        epoch_number,
+        light_cache_num_items,
+        light_cache,
+        l1_cache,
+        full_dataset_num_items,
+        full_dataset,
+        full_dataset_claimed,
+        full_dataset_ready,
+    };
+}
+
+void store(std::shared_ptr<const epoch_context> owner, bool full)
+{
+    std::string directory = get_cache_directory();
+    if (directory.empty() || !owner)
+        return;
+
+    try
+    {
+        std::thread{[owner, directory, full] { write_file(directory, *owner, full); }}.detach();
+    }
+    catch (const std::system_error&)
+    {
+        // No thread, no cache file. The next run generates the context again.
+    }
+}
+
+#else
+
+epoch_context_full* map_file(int, bool) noexcept
+{
+    return nullptr;
+}
+
+void store(std::shared_ptr<const epoch_context>, bool) {}
+
+#endif
+}  // namespace
+
+void set_context_cache_directory(const std::string& path)
+{
+#if ETHASH_CONTEXT_CACHE
+    // Create the missing directories along the path.
+    for (size_t pos = path.find('/', 1); !path.empty(); pos = path.find('/', pos + 1))
+    {
+        ::mkdir(path.substr(0, pos).c_str(), 0755);
+        if (pos == std::string::npos)
+            break;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock{cache_directory_mutex};
+    cache_directory = path;
+}
+
+epoch_context_ptr load_epoch_context(int epoch_number) noexcept
+{
+    return {map_file(epoch_number, false), ethash_destroy_epoch_context};
+}
+
+epoch_context_full_ptr load_epoch_context_full(int epoch_number) noexcept
+{
+    return {map_file(epoch_number, true), ethash_destroy_epoch_context_full};
+}
+
+void store_epoch_context(std::shared_ptr<const epoch_context> context)
+{
+    store(std::move(context), false);
+}
+
+void store_epoch_context_full(std::shared_ptr<const epoch_context_full> context)
+{
+    store(std::move(context), true);
+}
+}  // namespace ethash
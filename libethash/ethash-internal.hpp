@@ -12,6 +12,7 @@
 
 #include "endianness.hpp"
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -19,12 +20,21 @@ extern "C" struct ethash_epoch_context_full : ethash_epoch_context
 {
     ethash_hash1024* full_dataset;
 
+    /// Generation state of the full dataset items, one bit per item in each bitmap.
+    /// An item is generated by the thread which has set its bit in the claimed bitmap and
+    /// can be read by anyone once its bit in the ready bitmap is set.
+    std::atomic<uint64_t>* full_dataset_claimed;
+    std::atomic<uint64_t>* full_dataset_ready;
+
     constexpr ethash_epoch_context_full(int epoch_number, int light_cache_num_items,
         const ethash_hash512* light_cache, const uint32_t* l1_cache, int full_dataset_num_items,
-        ethash_hash1024* full_dataset) noexcept
+        ethash_hash1024* full_dataset, std::atomic<uint64_t>* full_dataset_claimed,
+        std::atomic<uint64_t>* full_dataset_ready) noexcept
       : ethash_epoch_context{epoch_number, light_cache_num_items, light_cache, l1_cache,
             full_dataset_num_items},
-        full_dataset{full_dataset}
+        full_dataset{full_dataset},
+        full_dataset_claimed{full_dataset_claimed},
+        full_dataset_ready{full_dataset_ready}
     {}
 };
 
@@ -53,6 +63,42 @@ hash512 calculate_dataset_item_512(const epoch_context& context, int64_t index)
 hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t index) noexcept;
 hash2048 calculate_dataset_item_2048(const epoch_context& context, uint32_t index) noexcept;
 
+/// Returns the full dataset item, generating it when used for the first time.
+///
+/// Safe to be called concurrently: every item is generated exactly once and threads hitting
+/// an item under generation wait for it to be published.
+hash1024 lazy_lookup_1024(const epoch_context_full& context, uint32_t index) noexcept;
+
+/// The same as lazy_lookup_1024() but for the 2048-bit items used by ProgPoW.
+hash2048 lazy_lookup_2048(const epoch_context_full& context, uint32_t index) noexcept;
+
+/// Maps the context of the epoch from the on-disk cache.
+///
+/// @return  The context or null if the cache is disabled or has no valid file for the epoch.
+epoch_context_ptr load_epoch_context(int epoch_number) noexcept;
+
+/// The same as load_epoch_context() but for the contexts with the complete full dataset.
+epoch_context_full_ptr load_epoch_context_full(int epoch_number) noexcept;
+
+/// Writes the context into the on-disk cache in a background thread holding the context.
+void store_epoch_context(std::shared_ptr<const epoch_context> context);
+
+/// Writes the context into the on-disk cache. The full dataset must be complete.
+void store_epoch_context_full(std::shared_ptr<const epoch_context_full> context);
+
+/// Allocates zeroed memory for an epoch context from the largest pages available,
+/// see set_max_memory_mode().
+///
+/// @param mode  Receives the kind of memory allocated.
+/// @return      The memory or null if out of memory.
+void* allocate_context_memory(size_t size, memory_mode& mode) noexcept;
+
+/// Makes memory mapped elsewhere known to get_memory_mode() and free_context_memory().
+void register_context_memory(void* p, size_t size, memory_mode mode) noexcept;
+
+/// Frees the memory from allocate_context_memory() or register_context_memory().
+void free_context_memory(void* p) noexcept;
+
 namespace generic
 {
 using hash_fn_512 = hash512 (*)(const uint8_t* data, size_t size);
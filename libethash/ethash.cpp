@@ -11,10 +11,16 @@
 #include <ethash/keccak.hpp>
 #include <ethash/progpow.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace ethash
 {
@@ -54,46 +60,160 @@ inline hash512 bitwise_xor(const hash512& x, const hash512& y) noexcept
 }
 }  // namespace
 
-int find_epoch_number(const hash256& seed) noexcept
+namespace
 {
-    static constexpr int num_tries = 30000;  // Divisible by 16.
+int compute_light_cache_num_items(int epoch_number) noexcept
+{
+    static constexpr int item_size = sizeof(hash512);
+    static constexpr int num_items_init = light_cache_init_size / item_size;
+    static constexpr int num_items_growth = light_cache_growth / item_size;
+    static_assert(
+        light_cache_init_size % item_size == 0, "light_cache_init_size not multiple of item size");
+    static_assert(
+        light_cache_growth % item_size == 0, "light_cache_growth not multiple of item size");
 
-    // Thread-local cache of the last search.
-    static thread_local int cached_epoch_number = 0;
-    static thread_local hash256 cached_seed = {};
+    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
+    int num_items = ethash_find_largest_prime(num_items_upper_bound);
+    return num_items;
+}
+
+int compute_full_dataset_num_items(int epoch_number) noexcept
+{
+    static constexpr int item_size = sizeof(hash1024);
+    static constexpr int num_items_init = full_dataset_init_size / item_size;
+    static constexpr int num_items_growth = full_dataset_growth / item_size;
+    static_assert(full_dataset_init_size % item_size == 0,
+        "full_dataset_init_size not multiple of item size");
+    static_assert(
+        full_dataset_growth % item_size == 0, "full_dataset_growth not multiple of item size");
+
+    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
+    int num_items = ethash_find_largest_prime(num_items_upper_bound);
+    return num_items;
+}
 
-    // Load from memory once (memory will be clobbered by keccak256()).
-    const uint32_t seed_part = seed.word32s[0];
-    const int e = cached_epoch_number;
-    hash256 s = cached_seed;
+/// The process-wide index of the epoch seeds and sizes.
+///
+/// The seeds form a hash chain, so the index extends the chain only as far as it has been asked
+/// for and maps every seed met on the way back to its epoch number. The item counts are computed
+/// on first use. The first num_epochs epochs are indexed, the later ones are computed every time.
+class epoch_index
+{
+public:
+    /// The same range as find_epoch_number() has always searched.
+    static constexpr int num_epochs = 30000;
+
+    int find(const hash256& seed) noexcept
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
 
-    if (s.word32s[0] == seed_part)
-        return e;
+        auto it = epochs_.find(seed.word64s[0]);
+        if (it == epochs_.end() && seeds_.size() < num_epochs)
+        {
+            // Unknown seed, the rest of the chain has to be built to tell.
+            extend(num_epochs - 1);
+            it = epochs_.find(seed.word64s[0]);
+        }
+
+        if (it == epochs_.end() || !is_equal(seeds_[static_cast<size_t>(it->second)], seed))
+            return -1;
+        return it->second;
+    }
 
-    // Try the next seed, will match for sequential epoch access.
-    s = keccak256(s);
-    if (s.word32s[0] == seed_part)
+    hash256 seed(int epoch_number) noexcept
     {
-        cached_seed = s;
-        cached_epoch_number = e + 1;
-        return e + 1;
+        if (epoch_number <= 0)
+            return {};
+
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        extend(std::min(epoch_number, num_epochs - 1));
+        hash256 s = seeds_[static_cast<size_t>(std::min(epoch_number, num_epochs - 1))];
+        for (int i = num_epochs - 1; i < epoch_number; ++i)
+            s = keccak256(s);
+        return s;
     }
 
-    // Search for matching seed starting from epoch 0.
-    s = {};
-    for (int i = 0; i < num_tries; ++i)
+    int light_cache_num_items(int epoch_number) noexcept
     {
-        if (s.word32s[0] == seed_part)
+        return cached(light_cache_num_items_, epoch_number, compute_light_cache_num_items);
+    }
+
+    int full_dataset_num_items(int epoch_number) noexcept
+    {
+        return cached(full_dataset_num_items_, epoch_number, compute_full_dataset_num_items);
+    }
+
+private:
+    /// Extends the seed chain up to the given epoch. Requires the lock.
+    void extend(int epoch_number)
+    {
+        if (seeds_.empty())
+        {
+            seeds_.push_back({});
+            epochs_.emplace(seeds_.back().word64s[0], 0);
+        }
+
+        while (static_cast<int>(seeds_.size()) <= epoch_number)
         {
-            cached_seed = s;
-            cached_epoch_number = i;
-            return i;
+            seeds_.push_back(keccak256(seeds_.back()));
+            epochs_.emplace(seeds_.back().word64s[0], static_cast<int>(seeds_.size() - 1));
         }
+    }
+
+    /// Returns the count from the table, computing it when not there yet.
+    ///
+    /// The counts never change, so concurrent misses at worst compute the same value twice.
+    static int cached(std::atomic<int> (&table)[num_epochs], int epoch_number,
+        int (*compute)(int)) noexcept
+    {
+        if (epoch_number < 0 || epoch_number >= num_epochs)
+            return compute(epoch_number);
 
-        s = keccak256(s);
+        int num_items = table[epoch_number].load(std::memory_order_relaxed);
+        if (num_items == 0)
+        {
+            num_items = compute(epoch_number);
+            table[epoch_number].store(num_items, std::memory_order_relaxed);
+        }
+        return num_items;
     }
 
-    return -1;
+    std::mutex mutex_;
+    std::vector<hash256> seeds_;
+
+    /// The epoch numbers by the first 8 bytes of the seeds.
+    std::unordered_map<uint64_t, int> epochs_;
+
+    std::atomic<int> light_cache_num_items_[num_epochs] = {};
+    std::atomic<int> full_dataset_num_items_[num_epochs] = {};
+};
+
+constexpr int epoch_index::num_epochs;
+
+epoch_index& get_epoch_index() noexcept
+{
+    static epoch_index index;
+    return index;
+}
+}  // namespace
+
+int find_epoch_number(const hash256& seed) noexcept
+{
+    // Thread-local cache of the last search, pools keep sending the same seed.
+    static thread_local int cached_epoch_number = -1;
+    static thread_local hash256 cached_seed = {};
+
+    if (cached_epoch_number >= 0 && is_equal(cached_seed, seed))
+        return cached_epoch_number;
+
+    const int epoch_number = get_epoch_index().find(seed);
+    if (epoch_number >= 0)
+    {
+        cached_seed = seed;
+        cached_epoch_number = epoch_number;
+    }
+    return epoch_number;
 }
 
 namespace generic
@@ -141,9 +261,15 @@ epoch_context_full* create_epoch_context(
         full ? static_cast<size_t>(full_dataset_num_items) * sizeof(hash1024) :
                progpow::l1_cache_size;
 
-    const size_t alloc_size = context_alloc_size + light_cache_size + full_dataset_size;
+    // The generation state bitmaps of the full dataset items follow the full dataset.
+    const size_t bitmap_num_words = full ? (static_cast<size_t>(full_dataset_num_items) + 63) / 64 : 0;
+    const size_t bitmap_size = bitmap_num_words * sizeof(std::atomic<uint64_t>);
+
+    const size_t alloc_size =
+        context_alloc_size + light_cache_size + full_dataset_size + 2 * bitmap_size;
 
-    char* const alloc_data = static_cast<char*>(std::calloc(1, alloc_size));
+    memory_mode mode;
+    char* const alloc_data = static_cast<char*>(allocate_context_memory(alloc_size, mode));
     if (!alloc_data)
         return nullptr;  // Signal out-of-memory by returning null pointer.
 
@@ -156,6 +282,18 @@ epoch_context_full* create_epoch_context(
 
     hash1024* full_dataset = full ? reinterpret_cast<hash1024*>(l1_cache) : nullptr;
 
+    std::atomic<uint64_t>* full_dataset_claimed = nullptr;
+    std::atomic<uint64_t>* full_dataset_ready = nullptr;
+    if (full)
+    {
+        char* const bitmaps_data =
+            alloc_data + context_alloc_size + light_cache_size + full_dataset_size;
+        full_dataset_claimed = reinterpret_cast<std::atomic<uint64_t>*>(bitmaps_data);
+        full_dataset_ready = reinterpret_cast<std::atomic<uint64_t>*>(bitmaps_data + bitmap_size);
+        for (size_t i = 0; i < 2 * bitmap_num_words; ++i)
+            new (&full_dataset_claimed[i]) std::atomic<uint64_t>{0};
+    }
+
     epoch_context_full* const context = new (alloc_data) epoch_context_full{
         epoch_number,
         light_cache_num_items,
@@ -163,11 +301,25 @@ epoch_context_full* create_epoch_context(
         l1_cache,
         full_dataset_num_items,
         full_dataset,
+        full_dataset_claimed,
+        full_dataset_ready,
     };
 
     auto* full_dataset_2048 = reinterpret_cast<hash2048*>(l1_cache);
     for (uint32_t i = 0; i < progpow::l1_cache_size / sizeof(full_dataset_2048[0]); ++i)
         full_dataset_2048[i] = calculate_dataset_item_2048(*context, i);
+
+    // The L1 cache is the beginning of the full dataset so these items are ready already.
+    if (full)
+    {
+        static constexpr size_t l1_num_items = progpow::l1_cache_size / sizeof(hash1024);
+        static_assert(l1_num_items % 64 == 0, "L1 cache items do not fill bitmap words");
+        for (size_t i = 0; i < l1_num_items / 64; ++i)
+        {
+            full_dataset_claimed[i].store(~uint64_t{0}, std::memory_order_relaxed);
+            full_dataset_ready[i].store(~uint64_t{0}, std::memory_order_relaxed);
+        }
+    }
     return context;
 }
 }  // namespace generic
@@ -250,6 +402,143 @@ hash2048 calculate_dataset_item_2048(const epoch_context& context, uint32_t inde
     return hash2048{{item0.final(), item1.final(), item2.final(), item3.final()}};
 }
 
+namespace
+{
+/// Generates the items in the range [begin, end) which have not been claimed by other threads yet.
+///
+/// The items are claimed and published a bitmap word at a time, the begin index must be
+/// a multiple of 64.
+void materialize_items(const epoch_context_full& context, int begin, int end) noexcept
+{
+    for (int word_begin = begin; word_begin < end; word_begin += 64)
+    {
+        const int word_end = std::min(word_begin + 64, end);
+        const size_t w = static_cast<size_t>(word_begin) / 64;
+        const uint64_t mask = word_end - word_begin == 64 ?
+                                  ~uint64_t{0} :
+                                  (uint64_t{1} << (word_end - word_begin)) - 1;
+
+        const uint64_t claimed =
+            mask & ~context.full_dataset_claimed[w].fetch_or(mask, std::memory_order_acq_rel);
+        if (claimed == 0)
+            continue;
+
+        for (int i = word_begin; i < word_end; ++i)
+        {
+            if (claimed & (uint64_t{1} << (i - word_begin)))
+            {
+                context.full_dataset[i] =
+                    calculate_dataset_item_1024(context, static_cast<uint32_t>(i));
+            }
+        }
+
+        context.full_dataset_ready[w].fetch_or(claimed, std::memory_order_release);
+    }
+}
+
+/// The number of full dataset items processed by a build worker in one go.
+/// It is also the granularity of the cancellation checks and progress reports.
+constexpr int build_chunk_size = 4096;
+static_assert(build_chunk_size % 64 == 0, "build chunks must cover whole bitmap words");
+
+struct build_state
+{
+    build_state(const epoch_context_full& context, const std::atomic<bool>* cancel) noexcept
+      : context{context}, cancel{cancel}
+    {}
+
+    const epoch_context_full& context;
+    const std::atomic<bool>* const cancel;
+    std::atomic<int> next_item{0};
+    std::atomic<int> num_items_done{0};
+};
+
+/// Claims chunks of the full dataset and fills them until there is nothing left or the build
+/// is cancelled. Only the calling thread passes the progress callback, so it is never invoked
+/// concurrently.
+void build_full_dataset_worker(build_state& state, const build_progress_fn* progress) noexcept
+{
+    const int num_items = state.context.full_dataset_num_items;
+    while (!state.cancel || !state.cancel->load(std::memory_order_relaxed))
+    {
+        const int begin = state.next_item.fetch_add(build_chunk_size, std::memory_order_relaxed);
+        if (begin >= num_items)
+            break;
+
+        const int end = std::min(begin + build_chunk_size, num_items);
+        materialize_items(state.context, begin, end);
+
+        const int done = state.num_items_done.fetch_add(end - begin) + (end - begin);
+        if (progress && *progress)
+            (*progress)(done, num_items);
+    }
+}
+}  // namespace
+
+bool build_full_dataset(const epoch_context_full& context, const build_options& options) noexcept
+{
+    unsigned num_threads = options.num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    build_state state{context, options.cancel};
+
+    // The calling thread is a worker too, so one helper less is needed.
+    // If a thread cannot be created carry on with the ones we already have.
+    std::vector<std::thread> helpers;
+    try
+    {
+        for (unsigned i = 1; i < num_threads; ++i)
+            helpers.emplace_back(build_full_dataset_worker, std::ref(state), nullptr);
+    }
+    catch (...)
+    {
+    }
+
+    build_full_dataset_worker(state, &options.progress);
+
+    for (auto& t : helpers)
+        t.join();
+
+    const int done = state.num_items_done.load();
+    if (options.progress)
+        options.progress(done, context.full_dataset_num_items);
+    return done == context.full_dataset_num_items;
+}
+
+hash1024 lazy_lookup_1024(const epoch_context_full& context, uint32_t index) noexcept
+{
+    const size_t w = index / 64;
+    const uint64_t bit = uint64_t{1} << (index % 64);
+
+    // Fast path: the item has been published already.
+    if (context.full_dataset_ready[w].load(std::memory_order_acquire) & bit)
+        return context.full_dataset[index];
+
+    if (!(context.full_dataset_claimed[w].fetch_or(bit, std::memory_order_acq_rel) & bit))
+    {
+        // This thread has claimed the item, generate and publish it.
+        const hash1024 item = calculate_dataset_item_1024(context, index);
+        context.full_dataset[index] = item;
+        context.full_dataset_ready[w].fetch_or(bit, std::memory_order_release);
+        return item;
+    }
+
+    // Another thread is generating the item. This takes about as long as a few context switches.
+    while (!(context.full_dataset_ready[w].load(std::memory_order_acquire) & bit))
+        std::this_thread::yield();
+
+    return context.full_dataset[index];
+}
+
+hash2048 lazy_lookup_2048(const epoch_context_full& context, uint32_t index) noexcept
+{
+    // The 2048-bit item i consists of the 1024-bit items 2i and 2i+1.
+    const hash1024 lo = lazy_lookup_1024(context, index * 2);
+    const hash1024 hi = lazy_lookup_1024(context, index * 2 + 1);
+    return hash2048{{lo.hash512s[0], lo.hash512s[1], hi.hash512s[0], hi.hash512s[1]}};
+}
+
 namespace
 {
 using lookup_fn = hash1024 (*)(const epoch_context&, uint32_t);
@@ -272,6 +561,62 @@ inline hash256 hash_final(const hash512& seed, const hash256& mix_hash)
     return keccak256(final_data, sizeof(final_data));
 }
 
+/// The number of nonces hashed together by search() and search_light().
+constexpr size_t search_batch_size = 8;
+
+/// Computes hash_seed() of search_batch_size consecutive nonces with the multi-buffer Keccak.
+inline void hash_seeds(hash512 seeds[search_batch_size], const hash256& header_hash,
+    uint64_t start_nonce) noexcept
+{
+    uint8_t init_data[search_batch_size][sizeof(header_hash) + sizeof(start_nonce)];
+    const uint8_t* data[search_batch_size];
+    for (size_t i = 0; i < search_batch_size; ++i)
+    {
+        const uint64_t nonce = le::uint64(start_nonce + i);
+        std::memcpy(&init_data[i][0], &header_hash, sizeof(header_hash));
+        std::memcpy(&init_data[i][sizeof(header_hash)], &nonce, sizeof(nonce));
+        data[i] = init_data[i];
+    }
+    keccak512x8(seeds, data, sizeof(init_data[0]));
+}
+
+/// Computes hash_final() of search_batch_size nonces with the multi-buffer Keccak.
+inline void hash_finals(hash256 final_hashes[search_batch_size],
+    const hash512 seeds[search_batch_size], const hash256 mix_hashes[search_batch_size]) noexcept
+{
+    uint8_t final_data[search_batch_size][sizeof(hash512) + sizeof(hash256)];
+    const uint8_t* data[search_batch_size];
+    for (size_t i = 0; i < search_batch_size; ++i)
+    {
+        std::memcpy(&final_data[i][0], seeds[i].bytes, sizeof(seeds[i]));
+        std::memcpy(&final_data[i][sizeof(hash512)], mix_hashes[i].bytes, sizeof(mix_hashes[i]));
+        data[i] = final_data[i];
+    }
+    keccak256x8(final_hashes, data, sizeof(final_data[0]));
+}
+
+hash1024 lazy_lookup(const epoch_context& context, uint32_t index) noexcept
+{
+    return lazy_lookup_1024(static_cast<const epoch_context_full&>(context), index);
+}
+
+/// Reduces the 1024-bit mix to the 256-bit mix hash.
+inline hash256 compress_mix(const hash1024& mix) noexcept
+{
+    static constexpr size_t num_words = sizeof(hash1024) / sizeof(uint32_t);
+
+    hash256 mix_hash;
+    for (size_t i = 0; i < num_words; i += 4)
+    {
+        const uint32_t h1 = fnv1(mix.word32s[i], mix.word32s[i + 1]);
+        const uint32_t h2 = fnv1(h1, mix.word32s[i + 2]);
+        const uint32_t h3 = fnv1(h2, mix.word32s[i + 3]);
+        mix_hash.word32s[i / 4] = h3;
+    }
+
+    return le::uint32s(mix_hash);
+}
+
 inline hash256 hash_kernel(
     const epoch_context& context, const hash512& seed, lookup_fn lookup) noexcept
 {
@@ -290,16 +635,56 @@ inline hash256 hash_kernel(
             mix.word32s[j] = fnv1(mix.word32s[j], newdata.word32s[j]);
     }
 
-    hash256 mix_hash;
-    for (size_t i = 0; i < num_words; i += 4)
+    return compress_mix(mix);
+}
+
+/// Runs hash_kernel() for NumNonces nonces in lockstep.
+///
+/// The dataset indexes of all the nonces are known before any lookup of the step,
+/// so when the full dataset is given their items are prefetched and the memory latency
+/// of one nonce is hidden behind the mixing of the others.
+template <size_t NumNonces>
+inline void hash_kernel_batch(hash256 mix_hashes[NumNonces], const epoch_context& context,
+    const hash512 seeds[NumNonces], lookup_fn lookup, const hash1024* full_dataset) noexcept
+{
+    static constexpr size_t num_words = sizeof(hash1024) / sizeof(uint32_t);
+    const uint32_t index_limit = static_cast<uint32_t>(context.full_dataset_num_items);
+
+    uint32_t seed_inits[NumNonces];
+    hash1024 mixes[NumNonces];
+    for (size_t k = 0; k < NumNonces; ++k)
     {
-        const uint32_t h1 = fnv1(mix.word32s[i], mix.word32s[i + 1]);
-        const uint32_t h2 = fnv1(h1, mix.word32s[i + 2]);
-        const uint32_t h3 = fnv1(h2, mix.word32s[i + 3]);
-        mix_hash.word32s[i / 4] = h3;
+        seed_inits[k] = le::uint32(seeds[k].word32s[0]);
+        mixes[k] = hash1024{{le::uint32s(seeds[k]), le::uint32s(seeds[k])}};
     }
 
-    return le::uint32s(mix_hash);
+    for (uint32_t i = 0; i < num_dataset_accesses; ++i)
+    {
+        uint32_t indexes[NumNonces];
+        for (size_t k = 0; k < NumNonces; ++k)
+            indexes[k] = fnv1(i ^ seed_inits[k], mixes[k].word32s[i % num_words]) % index_limit;
+
+        if (full_dataset)
+        {
+            for (size_t k = 0; k < NumNonces; ++k)
+            {
+                // The 128-byte item spans 2 cache lines.
+                PREFETCH(&full_dataset[indexes[k]].bytes[0]);
+                PREFETCH(&full_dataset[indexes[k]].bytes[64]);
+            }
+        }
+
+        for (size_t k = 0; k < NumNonces; ++k)
+        {
+            const hash1024 newdata = le::uint32s(lookup(context, indexes[k]));
+
+            for (size_t j = 0; j < num_words; ++j)
+                mixes[k].word32s[j] = fnv1(mixes[k].word32s[j], newdata.word32s[j]);
+        }
+    }
+
+    for (size_t k = 0; k < NumNonces; ++k)
+        mix_hashes[k] = compress_mix(mixes[k]);
 }
 }  // namespace
 
@@ -312,19 +697,6 @@ result hash(const epoch_context& context, const hash256& header_hash, uint64_t n
 
 result hash(const epoch_context_full& context, const hash256& header_hash, uint64_t nonce) noexcept
 {
-    static const auto lazy_lookup = [](const epoch_context& context, uint32_t index) noexcept
-    {
-        auto full_dataset = static_cast<const epoch_context_full&>(context).full_dataset;
-        hash1024& item = full_dataset[index];
-        if (item.word64s[0] == 0)
-        {
-            // TODO: Copy elision here makes it thread-safe?
-            item = calculate_dataset_item_1024(context, index);
-        }
-
-        return item;
-    };
-
     const hash512 seed = hash_seed(header_hash, nonce);
     const hash256 mix_hash = hash_kernel(context, seed, lazy_lookup);
     return {hash_final(seed, mix_hash), mix_hash};
@@ -348,30 +720,62 @@ bool verify(const epoch_context& context, const hash256& header_hash, const hash
     return is_equal(expected_mix_hash, mix_hash);
 }
 
-search_result search_light(const epoch_context& context, const hash256& header_hash,
-    const hash256& boundary, uint64_t start_nonce, size_t iterations) noexcept
+namespace
+{
+/// Searches nonces in batches sharing the multi-buffer Keccak for the seed and final hashes.
+/// The results are the same as hashing the nonces one by one.
+/// The mixes of a batch run in lockstep with hash_kernel_batch(), prefetching from
+/// the full dataset if one is given.
+search_result search_batched(const epoch_context& context, const hash256& header_hash,
+    const hash256& boundary, uint64_t start_nonce, size_t iterations, lookup_fn lookup,
+    const hash1024* full_dataset) noexcept
 {
-    const uint64_t end_nonce = start_nonce + iterations;
-    for (uint64_t nonce = start_nonce; nonce < end_nonce; ++nonce)
+    size_t i = 0;
+    for (; iterations - i >= search_batch_size; i += search_batch_size)
+    {
+        const uint64_t nonce = start_nonce + i;
+
+        hash512 seeds[search_batch_size];
+        hash_seeds(seeds, header_hash, nonce);
+
+        hash256 mix_hashes[search_batch_size];
+        hash_kernel_batch<search_batch_size>(mix_hashes, context, seeds, lookup, full_dataset);
+
+        hash256 final_hashes[search_batch_size];
+        hash_finals(final_hashes, seeds, mix_hashes);
+
+        for (size_t j = 0; j < search_batch_size; ++j)
+        {
+            if (is_less_or_equal(final_hashes[j], boundary))
+                return {{final_hashes[j], mix_hashes[j]}, nonce + j};
+        }
+    }
+
+    for (; i < iterations; ++i)
     {
-        result r = hash(context, header_hash, nonce);
-        if (is_less_or_equal(r.final_hash, boundary))
-            return {r, nonce};
+        const uint64_t nonce = start_nonce + i;
+        const hash512 seed = hash_seed(header_hash, nonce);
+        const hash256 mix_hash = hash_kernel(context, seed, lookup);
+        const hash256 final_hash = hash_final(seed, mix_hash);
+        if (is_less_or_equal(final_hash, boundary))
+            return {{final_hash, mix_hash}, nonce};
     }
     return {};
 }
+}  // namespace
+
+search_result search_light(const epoch_context& context, const hash256& header_hash,
+    const hash256& boundary, uint64_t start_nonce, size_t iterations) noexcept
+{
+    return search_batched(context, header_hash, boundary, start_nonce, iterations,
+        calculate_dataset_item_1024, nullptr);
+}
 
 search_result search(const epoch_context_full& context, const hash256& header_hash,
     const hash256& boundary, uint64_t start_nonce, size_t iterations) noexcept
 {
-    const uint64_t end_nonce = start_nonce + iterations;
-    for (uint64_t nonce = start_nonce; nonce < end_nonce; ++nonce)
-    {
-        result r = hash(context, header_hash, nonce);
-        if (is_less_or_equal(r.final_hash, boundary))
-            return {r, nonce};
-    }
-    return {};
+    return search_batched(context, header_hash, boundary, start_nonce, iterations, lazy_lookup,
+        context.full_dataset);
 }
 }  // namespace ethash
 
@@ -381,40 +785,17 @@ extern "C" {
 
 ethash_hash256 ethash_calculate_epoch_seed(int epoch_number) noexcept
 {
-    ethash_hash256 epoch_seed = {};
-    for (int i = 0; i < epoch_number; ++i)
-        epoch_seed = ethash_keccak256_32(epoch_seed.bytes);
-    return epoch_seed;
+    return get_epoch_index().seed(epoch_number);
 }
 
 int ethash_calculate_light_cache_num_items(int epoch_number) noexcept
 {
-    static constexpr int item_size = sizeof(hash512);
-    static constexpr int num_items_init = light_cache_init_size / item_size;
-    static constexpr int num_items_growth = light_cache_growth / item_size;
-    static_assert(
-        light_cache_init_size % item_size == 0, "light_cache_init_size not multiple of item size");
-    static_assert(
-        light_cache_growth % item_size == 0, "light_cache_growth not multiple of item size");
-
-    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
-    int num_items = ethash_find_largest_prime(num_items_upper_bound);
-    return num_items;
+    return get_epoch_index().light_cache_num_items(epoch_number);
 }
 
 int ethash_calculate_full_dataset_num_items(int epoch_number) noexcept
 {
-    static constexpr int item_size = sizeof(hash1024);
-    static constexpr int num_items_init = full_dataset_init_size / item_size;
-    static constexpr int num_items_growth = full_dataset_growth / item_size;
-    static_assert(full_dataset_init_size % item_size == 0,
-        "full_dataset_init_size not multiple of item size");
-    static_assert(
-        full_dataset_growth % item_size == 0, "full_dataset_growth not multiple of item size");
-
-    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
-    int num_items = ethash_find_largest_prime(num_items_upper_bound);
-    return num_items;
+    return get_epoch_index().full_dataset_num_items(epoch_number);
 }
 
 epoch_context* ethash_create_epoch_context(int epoch_number) noexcept
@@ -435,7 +816,7 @@ void ethash_destroy_epoch_context_full(epoch_context_full* context) noexcept
 void ethash_destroy_epoch_context(epoch_context* context) noexcept
 {
     context->~epoch_context();
-    std::free(context);
+    free_context_memory(context);
 }
 
 }  // extern "C"
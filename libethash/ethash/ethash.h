@@ -49,6 +49,7 @@ struct ethash_epoch_context_full;
  *
  * This function will search for a prime number matching the criteria given
  * by the Ethash so the execution time is not constant. It takes ~ 0.01 ms.
+ * The result is cached for the next calls with the same epoch number.
  *
  * @param epoch_number  The epoch number.
  * @return              The number items in the light cache.
@@ -61,6 +62,7 @@ int ethash_calculate_light_cache_num_items(int epoch_number) NOEXCEPT;
  *
  * This function will search for a prime number matching the criteria given
  * by the Ethash so the execution time is not constant. It takes ~ 0.05 ms.
+ * The result is cached for the next calls with the same epoch number.
  *
  * @param epoch_number  The epoch number.
  * @return              The number items in the full dataset.
@@ -69,6 +71,10 @@ int ethash_calculate_full_dataset_num_items(int epoch_number) NOEXCEPT;
 
 /**
  * Calculates the epoch seed hash.
+ *
+ * The seeds of the epochs up to the requested one are remembered, so the hash chain
+ * is computed only once per process.
+ *
  * @param epoch_number  The epoch number.
  * @return              The epoch seed hash.
  */
@@ -17,9 +17,12 @@
 #include <ethash/ethash.h>
 #include <ethash/hash_types.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace ethash
 {
@@ -123,6 +126,34 @@ inline epoch_context_full_ptr create_epoch_context_full(int epoch_number) noexce
     return {ethash_create_epoch_context_full(epoch_number), ethash_destroy_epoch_context_full};
 }
 
+/// Progress callback of the full dataset build.
+///
+/// Receives the number of items generated so far and the total number of items.
+using build_progress_fn = std::function<void(int num_items_done, int num_items_total)>;
+
+/// Options of the eager full dataset build.
+struct build_options
+{
+    /// The number of threads generating the dataset, including the calling one.
+    /// Zero means one thread per hardware thread.
+    unsigned num_threads = 0;
+
+    /// Optional progress callback. It is only invoked from the calling thread.
+    build_progress_fn progress;
+
+    /// Optional cancellation flag. The build stops soon after it is set to true.
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+/// Generates all items of the full dataset using a pool of worker threads.
+///
+/// Without it the items are generated lazily by hash() and search() when hit for the first
+/// time, so mining runs at light cache speed until most of the dataset has been touched.
+/// If the build is cancelled the context stays valid and the missing items are generated lazily.
+///
+/// @return  True if the full dataset is complete, false if the build has been cancelled.
+bool build_full_dataset(const epoch_context_full& context, const build_options& options) noexcept;
+
 
 result hash(const epoch_context& context, const hash256& header_hash, uint64_t nonce) noexcept;
 
@@ -147,14 +178,130 @@ search_result search(const epoch_context_full& context, const hash256& header_ha
 /// seed hash instead of epoch number to workers. This function tries to recover
 /// the epoch number from this seed hash.
 ///
+/// The first call with an unknown seed builds the index of the seeds of the first 30000 epochs,
+/// later lookups are hash map hits.
+///
 /// @param seed  Ethash seed hash.
 /// @return      The epoch number or -1 if not found.
 int find_epoch_number(const hash256& seed) noexcept;
 
 
+/// The kind of memory backing an epoch context, from the smallest to the largest pages.
+enum class memory_mode
+{
+    normal_pages,
+    transparent_huge_pages,
+    huge_pages_2mb,
+    huge_pages_1gb,
+
+    /// Mapped from a file of the on-disk cache, see set_context_cache_directory().
+    file_mapping,
+};
+
+/// Limits the pages of the epoch contexts created from now on.
+///
+/// The allocation tries the modes from the given one down to normal pages. By default all are
+/// tried, the explicit huge pages only succeed when reserved by the administrator
+/// (/proc/sys/vm/nr_hugepages or the hugepages= kernel parameter).
+void set_max_memory_mode(memory_mode mode) noexcept;
+
+/// Returns the kind of memory the context has got.
+memory_mode get_memory_mode(const epoch_context& context) noexcept;
+
+memory_mode get_memory_mode(const epoch_context_full& context) noexcept;
+
+/// Returns the name of the memory mode for the logs.
+const char* to_string(memory_mode mode) noexcept;
+
+/// Enables the on-disk cache of the epoch contexts in the given directory.
+///
+/// The global shared contexts are then mapped from the files written by the earlier runs
+/// instead of being generated, and the newly generated ones are written to the directory
+/// in the background. The full dataset is only written when built eagerly (see
+/// get_global_epoch_context_full() with build_options). An empty path disables the cache,
+/// which is the default.
+void set_context_cache_directory(const std::string& path);
+
+/// Options of the background build of the next epoch contexts.
+struct prebuild_options
+{
+    /// How many blocks before the epoch boundary the build starts.
+    int blocks_ahead = 1000;
+
+    /// The memory the contexts of the current and the next epoch may take together, in bytes.
+    /// When both do not fit, nothing is prebuilt and the contexts are replaced at the boundary.
+    uint64_t memory_budget = 0;
+
+    /// Also prebuild the context with full dataset, built with the given options.
+    bool full = false;
+    build_options build;
+};
+
+/// Sets the options of prebuild_epoch_contexts(). By default nothing is prebuilt.
+void set_prebuild_options(const prebuild_options& options);
+
+/// Reports the block number of the current work.
+///
+/// Near the end of the epoch the contexts of the next one are built by a low priority thread
+/// and the global shared contexts switch to them at the boundary. The threads reaching
+/// the boundary before the build ends wait for it.
+void prebuild_epoch_contexts(int block_number);
+
+/// Limits of the global shared epoch contexts kept for reuse.
+///
+/// Switching between pools on different epochs finds the contexts of the recent epochs ready.
+/// Beyond the limits the least recently used contexts are released before a new one is made.
+struct epoch_cache_limits
+{
+    /// The number of light contexts.
+    unsigned max_light = 3;
+
+    /// The number of contexts with full dataset, per NUMA node.
+    unsigned max_full = 1;
+
+    /// The memory all the contexts may take, in bytes. Zero means no limit.
+    uint64_t max_bytes = 0;
+};
+
+/// Counters of the global shared epoch contexts.
+struct epoch_cache_stats
+{
+    /// Contexts found ready and contexts mapped or built, by the threads switching epoch.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    /// Contexts released to stay within the limits.
+    uint64_t evictions = 0;
+
+    unsigned light_contexts = 0;
+    unsigned full_contexts = 0;
+    uint64_t bytes = 0;
+};
+
+void set_epoch_cache_limits(const epoch_cache_limits& limits) noexcept;
+
+epoch_cache_stats get_epoch_cache_stats();
+
 /// Get global shared epoch context.
 const epoch_context& get_global_epoch_context(int epoch_number);
 
 /// Get global shared epoch context with full dataset initialized.
 const epoch_context_full& get_global_epoch_context_full(int epoch_number);
+
+/// Get global shared epoch context with full dataset initialized.
+///
+/// When the context has to be created the full dataset is built eagerly with build_full_dataset()
+/// before the context is handed out to any thread.
+const epoch_context_full& get_global_epoch_context_full(
+    int epoch_number, const build_options& options);
+
+/// Get the replica of the epoch context with full dataset of the given NUMA node.
+///
+/// Each node has its own shared context, node 0 being the one of
+/// get_global_epoch_context_full(). Memory is placed on the node of the thread first touching it,
+/// so the replica should be created from a thread running on the node, with the build threads
+/// inheriting its CPU affinity. A thread keeps the context it got last, so the other
+/// get_global_epoch_context_full() calls of the thread for the same epoch return its replica.
+const epoch_context_full& get_numa_epoch_context_full(
+    int epoch_number, int numa_node, const build_options& options);
 }  // namespace ethash
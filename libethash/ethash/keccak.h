@@ -39,11 +39,50 @@ void ethash_keccakf1600(uint64_t state[25]) NOEXCEPT;
  */
 void ethash_keccakf800(uint32_t state[25]) NOEXCEPT;
 
+/**
+ * The multi-buffer Keccak-f[1600] functions.
+ *
+ * Perform the Keccak-f[1600] permutation on 4 or 8 independent states at once using SIMD
+ * instructions when the CPU supports them (AVX2 for 4 states, AVX-512F for 8 states, two
+ * AVX2 halves for 8 states without AVX-512F) and the scalar ethash_keccakf1600() otherwise.
+ * The results are the same in all cases.
+ *
+ * @param states  The interleaved states: the i-th word of the state j is states[i * N + j]
+ *                where N is the number of states.
+ */
+void ethash_keccakf1600x4(uint64_t states[4 * 25]) NOEXCEPT;
+void ethash_keccakf1600x8(uint64_t states[8 * 25]) NOEXCEPT;
+
+/**
+ * The multi-buffer Keccak-f[800] functions.
+ *
+ * Same as the multi-buffer Keccak-f[1600] functions, for 8 (AVX2) or 16 (AVX-512F)
+ * independent 32-bit word states.
+ */
+void ethash_keccakf800x8(uint32_t states[8 * 25]) NOEXCEPT;
+void ethash_keccakf800x16(uint32_t states[16 * 25]) NOEXCEPT;
+
 union ethash_hash256 ethash_keccak256(const uint8_t* data, size_t size) NOEXCEPT;
 union ethash_hash256 ethash_keccak256_32(const uint8_t data[32]) NOEXCEPT;
 union ethash_hash512 ethash_keccak512(const uint8_t* data, size_t size) NOEXCEPT;
 union ethash_hash512 ethash_keccak512_64(const uint8_t data[64]) NOEXCEPT;
 
+/**
+ * Batched Keccak hashes of several inputs of the same size.
+ *
+ * @param out   The array of the output hashes, one per input.
+ * @param data  The array of pointers to the inputs.
+ * @param size  The size of every input in bytes.
+ */
+void ethash_keccak256x4(
+    union ethash_hash256 out[4], const uint8_t* const data[4], size_t size) NOEXCEPT;
+void ethash_keccak256x8(
+    union ethash_hash256 out[8], const uint8_t* const data[8], size_t size) NOEXCEPT;
+void ethash_keccak512x4(
+    union ethash_hash512 out[4], const uint8_t* const data[4], size_t size) NOEXCEPT;
+void ethash_keccak512x8(
+    union ethash_hash512 out[8], const uint8_t* const data[8], size_t size) NOEXCEPT;
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,4 +32,28 @@ inline hash512 keccak512(const hash512& input) noexcept
 static constexpr auto keccak256_32 = ethash_keccak256_32;
 static constexpr auto keccak512_64 = ethash_keccak512_64;
 
+/// Batched Keccak-256 of 4 inputs of the same size.
+inline void keccak256x4(hash256 out[4], const uint8_t* const data[4], size_t size) noexcept
+{
+    ethash_keccak256x4(out, data, size);
+}
+
+/// Batched Keccak-256 of 8 inputs of the same size.
+inline void keccak256x8(hash256 out[8], const uint8_t* const data[8], size_t size) noexcept
+{
+    ethash_keccak256x8(out, data, size);
+}
+
+/// Batched Keccak-512 of 4 inputs of the same size.
+inline void keccak512x4(hash512 out[4], const uint8_t* const data[4], size_t size) noexcept
+{
+    ethash_keccak512x4(out, data, size);
+}
+
+/// Batched Keccak-512 of 8 inputs of the same size.
+inline void keccak512x8(hash512 out[8], const uint8_t* const data[8], size_t size) noexcept
+{
+    ethash_keccak512x8(out, data, size);
+}
+
 }  // namespace ethash
@@ -8,6 +8,8 @@
 ///
 /// This file provides the public API for ProgPoW as the Ethash API extension.
 
+#pragma once
+
 #include <ethash/ethash.hpp>
 
 namespace progpow
@@ -44,4 +46,42 @@ search_result search(const epoch_context_full& context, int block_number,
     const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
     size_t iterations) noexcept;
 
+/// Counters of the dataset item caches.
+struct item_cache_stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t items = 0;
+    size_t capacity = 0;
+};
+
+/// Sets the size in bytes of the cache of the dataset items computed by the light hashing,
+/// verification and search. Each of the last 4 epochs hashed gets its own cache.
+/// Zero disables it, which is the default.
+void set_item_cache_size(size_t size);
+
+/// Computes the first dataset items of the epoch into its cache, as many as fit.
+/// Zero threads means one thread per hardware thread.
+void prewarm_item_cache(const epoch_context& context, unsigned num_threads);
+
+item_cache_stats get_item_cache_stats();
+
+/// Loads the 2048-bit dataset item of the given index into 64 32-bit words.
+using native_lookup_fn = void (*)(const void* context, uint32_t index, uint32_t* item);
+
+/// The 64 rounds of the ProgPoW mix compiled natively for a period.
+///
+/// The mix is in the [register][lane] layout. The l1_cache and num_items (the number of
+/// the 2048-bit dataset items) come from the epoch context, the lookup function
+/// and its context are passed through.
+using native_rounds_fn = void (*)(uint32_t mix[num_regs][num_lanes], const uint32_t* l1_cache,
+    uint32_t num_items, native_lookup_fn lookup, const void* lookup_context);
+
+/// Registers the native rounds for the given period (block_number / period_length).
+///
+/// The hash, verify and search functions use them instead of the built-in implementation
+/// for the blocks of that period. Only one period can be registered, null unregisters it.
+/// The rounds must stay callable for the rest of the program.
+void set_native_rounds(uint64_t period, native_rounds_fn rounds) noexcept;
+
 }  // namespace progpow
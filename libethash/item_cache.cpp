@@ -0,0 +1,202 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+/// @file
+/// The cache of the dataset items computed by the light ProgPoW hashing.
+///
+/// Every item takes 1024 light cache parents to compute, so verifying the same shares again
+/// or shares of nearby nonces pays off keeping them. The cache is direct-mapped and split
+/// into shards, each with its own lock: the item of an index has a single slot, so the cache
+/// never grows beyond its size and holds the whole dataset when big enough.
+
+#include "ethash-internal.hpp"
+#include "progpow-internal.hpp"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace progpow
+{
+class item_cache
+{
+public:
+    item_cache(int epoch_number, size_t num_slots)
+      : epoch_number{epoch_number},
+        num_slots_per_shard{(num_slots + num_shards - 1) / num_shards}
+    {
+        for (auto& s : shards)
+            s.slots.resize(num_slots_per_shard);
+    }
+
+    bool get(uint32_t index, hash2048& item) noexcept
+    {
+        shard& s = shards[index % num_shards];
+        const slot& t = s.slots[(index / num_shards) % num_slots_per_shard];
+        std::lock_guard<std::mutex> lock{s.mutex};
+        if (t.tag != index + 1)
+        {
+            ++s.misses;
+            return false;
+        }
+        ++s.hits;
+        item = t.item;
+        return true;
+    }
+
+    void put(uint32_t index, const hash2048& item) noexcept
+    {
+        shard& s = shards[index % num_shards];
+        slot& t = s.slots[(index / num_shards) % num_slots_per_shard];
+        std::lock_guard<std::mutex> lock{s.mutex};
+        if (t.tag == 0)
+            ++s.num_items;
+        t.tag = index + 1;
+        t.item = item;
+    }
+
+    void add_stats(item_cache_stats& stats) noexcept
+    {
+        for (auto& s : shards)
+        {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            stats.hits += s.hits;
+            stats.misses += s.misses;
+            stats.items += s.num_items;
+        }
+        stats.capacity += num_shards * num_slots_per_shard;
+    }
+
+    size_t capacity() const noexcept { return num_shards * num_slots_per_shard; }
+
+    const int epoch_number;
+
+private:
+    static constexpr size_t num_shards = 64;
+
+    struct slot
+    {
+        uint64_t tag = 0;  ///< The index of the item plus one, zero when empty.
+        hash2048 item;
+    };
+
+    struct shard
+    {
+        std::mutex mutex;
+        std::vector<slot> slots;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t num_items = 0;
+    };
+
+    const size_t num_slots_per_shard;
+    shard shards[num_shards];
+};
+
+namespace
+{
+/// The caches of the most recent epochs.
+constexpr size_t max_caches = 4;
+
+std::mutex caches_mutex;
+std::deque<std::shared_ptr<item_cache>> caches;
+size_t cache_size = 0;
+
+thread_local item_cache* thread_item_cache = nullptr;
+
+std::shared_ptr<item_cache> get_cache(int epoch_number)
+{
+    std::lock_guard<std::mutex> lock{caches_mutex};
+    if (cache_size < sizeof(hash2048))
+        return {};
+
+    for (const auto& cache : caches)
+    {
+        if (cache->epoch_number == epoch_number)
+            return cache;
+    }
+
+    if (caches.size() == max_caches)
+        caches.pop_front();
+    caches.push_back(std::make_shared<item_cache>(epoch_number, cache_size / sizeof(hash2048)));
+    return caches.back();
+}
+
+hash2048 cached_lookup(const epoch_context& context, uint32_t index) noexcept
+{
+    hash2048 item;
+    if (thread_item_cache->get(index, item))
+        return item;
+    item = calculate_dataset_item_2048(context, index);
+    thread_item_cache->put(index, item);
+    return item;
+}
+}  // namespace
+
+light_lookup::light_lookup(const epoch_context& context) noexcept
+{
+    try
+    {
+        cache = get_cache(context.epoch_number);
+    }
+    catch (...)
+    {
+        // Out of memory, compute the items.
+    }
+    previous = thread_item_cache;
+    if (cache)
+        thread_item_cache = cache.get();
+}
+
+light_lookup::~light_lookup()
+{
+    thread_item_cache = previous;
+}
+
+lookup_fn light_lookup::get() const noexcept
+{
+    return cache ? cached_lookup : calculate_dataset_item_2048;
+}
+
+void set_item_cache_size(size_t size)
+{
+    std::lock_guard<std::mutex> lock{caches_mutex};
+    cache_size = size;
+    caches.clear();
+}
+
+void prewarm_item_cache(const epoch_context& context, unsigned num_threads)
+{
+    const std::shared_ptr<item_cache> cache = get_cache(context.epoch_number);
+    if (!cache)
+        return;
+
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+    const uint32_t end = static_cast<uint32_t>(std::min<size_t>(cache->capacity(), num_items));
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Fill the items of the first indexes, every one takes a distinct slot.
+    const auto fill = [&context, &cache, end, num_threads](uint32_t first) {
+        for (uint32_t i = first; i < end; i += num_threads)
+            cache->put(i, calculate_dataset_item_2048(context, i));
+    };
+    std::vector<std::thread> helpers;
+    for (unsigned t = 1; t < num_threads; ++t)
+        helpers.emplace_back(fill, t);
+    fill(0);
+    for (auto& helper : helpers)
+        helper.join();
+}
+
+item_cache_stats get_item_cache_stats()
+{
+    item_cache_stats stats;
+    std::lock_guard<std::mutex> lock{caches_mutex};
+    for (const auto& cache : caches)
+        cache->add_stats(stats);
+    return stats;
+}
+}  // namespace progpow
@@ -121,3 +121,86 @@ union ethash_hash512 ethash_keccak512_64(const uint8_t data[64])
     keccak(hash.word64s, 512, data, 64);
     return hash;
 }
+
+/**
+ * Keccak of several inputs of the same size at once.
+ *
+ * The same as keccak() with the states interleaved for the multi-buffer permutation.
+ * The output hash j is written to out[j * out_stride].
+ */
+static INLINE ALWAYS_INLINE void keccak_multi(uint64_t* out, size_t out_stride,
+    size_t num_states, void (*permute)(uint64_t*), size_t bits, const uint8_t* const data[],
+    size_t size)
+{
+    static const size_t word_size = sizeof(uint64_t);
+    const size_t hash_size = bits / 8;
+    const size_t block_size = (1600 - bits * 2) / 8;
+
+    size_t i, j, k;
+    size_t offset = 0;
+    size_t word_index;
+
+    uint64_t state[8 * 25] = {0};
+
+    while (size - offset >= block_size)
+    {
+        for (i = 0; i < (block_size / word_size); ++i)
+        {
+            for (j = 0; j < num_states; ++j)
+                state[i * num_states + j] ^= load_le(data[j] + offset + i * word_size);
+        }
+
+        permute(state);
+
+        offset += block_size;
+    }
+
+    word_index = 0;
+    while (size - offset >= word_size)
+    {
+        for (j = 0; j < num_states; ++j)
+            state[word_index * num_states + j] ^= load_le(data[j] + offset);
+        ++word_index;
+        offset += word_size;
+    }
+
+    for (j = 0; j < num_states; ++j)
+    {
+        uint64_t last_word = 0;
+        uint8_t* last_word_iter = (uint8_t*)&last_word;
+        for (k = offset; k < size; ++k)
+            *last_word_iter++ = data[j][k];
+        *last_word_iter = 0x01;
+        state[word_index * num_states + j] ^= to_le64(last_word);
+
+        state[((block_size / word_size) - 1) * num_states + j] ^= 0x8000000000000000;
+    }
+
+    permute(state);
+
+    for (j = 0; j < num_states; ++j)
+    {
+        for (i = 0; i < (hash_size / word_size); ++i)
+            out[j * out_stride + i] = to_le64(state[i * num_states + j]);
+    }
+}
+
+void ethash_keccak256x4(union ethash_hash256 out[4], const uint8_t* const data[4], size_t size)
+{
+    keccak_multi(out[0].word64s, 4, 4, ethash_keccakf1600x4, 256, data, size);
+}
+
+void ethash_keccak256x8(union ethash_hash256 out[8], const uint8_t* const data[8], size_t size)
+{
+    keccak_multi(out[0].word64s, 4, 8, ethash_keccakf1600x8, 256, data, size);
+}
+
+void ethash_keccak512x4(union ethash_hash512 out[4], const uint8_t* const data[4], size_t size)
+{
+    keccak_multi(out[0].word64s, 8, 4, ethash_keccakf1600x4, 512, data, size);
+}
+
+void ethash_keccak512x8(union ethash_hash512 out[8], const uint8_t* const data[8], size_t size)
+{
+    keccak_multi(out[0].word64s, 8, 8, ethash_keccakf1600x8, 512, data, size);
+}
@@ -253,3 +253,62 @@ void ethash_keccakf1600(uint64_t state[25])
     state[23] = Aso;
     state[24] = Asu;
 }
+
+#if ETHASH_X86_SIMD
+void ethash_keccakf1600x4_avx2(uint64_t states[4 * 25]);
+void ethash_keccakf1600x8_avx512(uint64_t states[8 * 25]);
+#endif
+
+/** Applies the scalar permutation to each of the interleaved states one by one. */
+static void keccakf1600_multi_scalar(uint64_t* states, int num_states)
+{
+    uint64_t state[25];
+    int i, j;
+    for (j = 0; j < num_states; ++j)
+    {
+        for (i = 0; i < 25; ++i)
+            state[i] = states[i * num_states + j];
+        ethash_keccakf1600(state);
+        for (i = 0; i < 25; ++i)
+            states[i * num_states + j] = state[i];
+    }
+}
+
+void ethash_keccakf1600x4(uint64_t states[4 * 25])
+{
+#if ETHASH_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+    {
+        ethash_keccakf1600x4_avx2(states);
+        return;
+    }
+#endif
+    keccakf1600_multi_scalar(states, 4);
+}
+
+void ethash_keccakf1600x8(uint64_t states[8 * 25])
+{
+#if ETHASH_X86_SIMD
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        ethash_keccakf1600x8_avx512(states);
+        return;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        /* Split into two 4-way halves. */
+        uint64_t halves[2][4 * 25];
+        int i, j;
+        for (i = 0; i < 25; ++i)
+            for (j = 0; j < 8; ++j)
+                halves[j / 4][i * 4 + j % 4] = states[i * 8 + j];
+        ethash_keccakf1600x4_avx2(halves[0]);
+        ethash_keccakf1600x4_avx2(halves[1]);
+        for (i = 0; i < 25; ++i)
+            for (j = 0; j < 8; ++j)
+                states[i * 8 + j] = halves[j / 4][i * 4 + j % 4];
+        return;
+    }
+#endif
+    keccakf1600_multi_scalar(states, 8);
+}
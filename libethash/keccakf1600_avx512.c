@@ -0,0 +1,25 @@
+/* ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+ * Copyright 2018 Pawel Bylica.
+ * Licensed under the Apache License, Version 2.0. See the LICENSE file.
+ */
+
+/* This file must be compiled with AVX-512F enabled. The caller checks the CPU supports it. */
+
+#include <immintrin.h>
+
+#define VEC __m512i
+#define LOAD(s, i) _mm512_loadu_si512((const void*)&(s)[(i)*8])
+#define STORE(s, i, v) _mm512_storeu_si512((void*)&(s)[(i)*8], (v))
+#define BROADCAST(x) _mm512_set1_epi64((long long)(x))
+#define XOR(a, b) _mm512_xor_si512((a), (b))
+#define XOR3(a, b, c) _mm512_ternarylogic_epi64((a), (b), (c), 0x96)
+#define XOR5(a, b, c, d, e) XOR3(XOR3(a, b, c), d, e)
+#define ROL(a, s) _mm512_rol_epi64((a), (s))
+#define CHI(a, b, c) _mm512_ternarylogic_epi64((a), (b), (c), 0xD2)
+
+#include "keccakf1600_multi.h"
+
+void ethash_keccakf1600x8_avx512(uint64_t states[8 * 25])
+{
+    keccakf1600_multi(states);
+}
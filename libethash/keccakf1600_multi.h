@@ -0,0 +1,271 @@
+/* ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+ * Copyright 2018 Pawel Bylica.
+ * Licensed under the Apache License, Version 2.0. See the LICENSE file.
+ */
+
+/**
+ * @file
+ * Multi-buffer Keccak-f[1600] permutation.
+ *
+ * This is ethash_keccakf1600() with every 64-bit word replaced by a SIMD vector holding
+ * the same word of several independent states. The including file must define:
+ *
+ * - VEC                the vector type,
+ * - LOAD(s, i)         loads the vector of the i-th words from the interleaved states s,
+ * - STORE(s, i, v)     stores the vector v of the i-th words to the interleaved states s,
+ * - BROADCAST(x)       returns the vector with x in every lane,
+ * - XOR(a, b)          a ^ b,
+ * - XOR5(a, b, c, d, e) a ^ b ^ c ^ d ^ e,
+ * - ROL(a, s)          rotates every lane left by the constant s,
+ * - CHI(a, b, c)       a ^ (~b & c).
+ *
+ * The interleaved layout keeps the i-th word of the state j at s[i * N + j] where N is
+ * the number of lanes of VEC.
+ */
+
+#pragma once
+
+#include "support/attributes.h"
+#include <stdint.h>
+
+static const uint64_t round_constants[24] = {
+    0x0000000000000001,
+    0x0000000000008082,
+    0x800000000000808a,
+    0x8000000080008000,
+    0x000000000000808b,
+    0x0000000080000001,
+    0x8000000080008081,
+    0x8000000000008009,
+    0x000000000000008a,
+    0x0000000000000088,
+    0x0000000080008009,
+    0x000000008000000a,
+    0x000000008000808b,
+    0x800000000000008b,
+    0x8000000000008089,
+    0x8000000000008003,
+    0x8000000000008002,
+    0x8000000000000080,
+    0x000000000000800a,
+    0x800000008000000a,
+    0x8000000080008081,
+    0x8000000000008080,
+    0x0000000080000001,
+    0x8000000080008008,
+};
+
+static INLINE ALWAYS_INLINE void keccakf1600_multi(uint64_t* state)
+{
+    int round;
+
+    VEC Aba, Abe, Abi, Abo, Abu;
+    VEC Aga, Age, Agi, Ago, Agu;
+    VEC Aka, Ake, Aki, Ako, Aku;
+    VEC Ama, Ame, Ami, Amo, Amu;
+    VEC Asa, Ase, Asi, Aso, Asu;
+
+    VEC Eba, Ebe, Ebi, Ebo, Ebu;
+    VEC Ega, Ege, Egi, Ego, Egu;
+    VEC Eka, Eke, Eki, Eko, Eku;
+    VEC Ema, Eme, Emi, Emo, Emu;
+    VEC Esa, Ese, Esi, Eso, Esu;
+
+    VEC Ba, Be, Bi, Bo, Bu;
+
+    VEC Da, De, Di, Do, Du;
+
+    Aba = LOAD(state, 0);
+    Abe = LOAD(state, 1);
+    Abi = LOAD(state, 2);
+    Abo = LOAD(state, 3);
+    Abu = LOAD(state, 4);
+    Aga = LOAD(state, 5);
+    Age = LOAD(state, 6);
+    Agi = LOAD(state, 7);
+    Ago = LOAD(state, 8);
+    Agu = LOAD(state, 9);
+    Aka = LOAD(state, 10);
+    Ake = LOAD(state, 11);
+    Aki = LOAD(state, 12);
+    Ako = LOAD(state, 13);
+    Aku = LOAD(state, 14);
+    Ama = LOAD(state, 15);
+    Ame = LOAD(state, 16);
+    Ami = LOAD(state, 17);
+    Amo = LOAD(state, 18);
+    Amu = LOAD(state, 19);
+    Asa = LOAD(state, 20);
+    Ase = LOAD(state, 21);
+    Asi = LOAD(state, 22);
+    Aso = LOAD(state, 23);
+    Asu = LOAD(state, 24);
+
+    for (round = 0; round < 24; round += 2)
+    {
+        /* Round (round + 0): Axx -> Exx */
+
+        Ba = XOR5(Aba, Aga, Aka, Ama, Asa);
+        Be = XOR5(Abe, Age, Ake, Ame, Ase);
+        Bi = XOR5(Abi, Agi, Aki, Ami, Asi);
+        Bo = XOR5(Abo, Ago, Ako, Amo, Aso);
+        Bu = XOR5(Abu, Agu, Aku, Amu, Asu);
+
+        Da = XOR(Bu, ROL(Be, 1));
+        De = XOR(Ba, ROL(Bi, 1));
+        Di = XOR(Be, ROL(Bo, 1));
+        Do = XOR(Bi, ROL(Bu, 1));
+        Du = XOR(Bo, ROL(Ba, 1));
+
+        Ba = XOR(Aba, Da);
+        Be = ROL(XOR(Age, De), 44);
+        Bi = ROL(XOR(Aki, Di), 43);
+        Bo = ROL(XOR(Amo, Do), 21);
+        Bu = ROL(XOR(Asu, Du), 14);
+        Eba = XOR(CHI(Ba, Be, Bi), BROADCAST(round_constants[round]));
+        Ebe = CHI(Be, Bi, Bo);
+        Ebi = CHI(Bi, Bo, Bu);
+        Ebo = CHI(Bo, Bu, Ba);
+        Ebu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Abo, Do), 28);
+        Be = ROL(XOR(Agu, Du), 20);
+        Bi = ROL(XOR(Aka, Da), 3);
+        Bo = ROL(XOR(Ame, De), 45);
+        Bu = ROL(XOR(Asi, Di), 61);
+        Ega = CHI(Ba, Be, Bi);
+        Ege = CHI(Be, Bi, Bo);
+        Egi = CHI(Bi, Bo, Bu);
+        Ego = CHI(Bo, Bu, Ba);
+        Egu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Abe, De), 1);
+        Be = ROL(XOR(Agi, Di), 6);
+        Bi = ROL(XOR(Ako, Do), 25);
+        Bo = ROL(XOR(Amu, Du), 8);
+        Bu = ROL(XOR(Asa, Da), 18);
+        Eka = CHI(Ba, Be, Bi);
+        Eke = CHI(Be, Bi, Bo);
+        Eki = CHI(Bi, Bo, Bu);
+        Eko = CHI(Bo, Bu, Ba);
+        Eku = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Abu, Du), 27);
+        Be = ROL(XOR(Aga, Da), 36);
+        Bi = ROL(XOR(Ake, De), 10);
+        Bo = ROL(XOR(Ami, Di), 15);
+        Bu = ROL(XOR(Aso, Do), 56);
+        Ema = CHI(Ba, Be, Bi);
+        Eme = CHI(Be, Bi, Bo);
+        Emi = CHI(Bi, Bo, Bu);
+        Emo = CHI(Bo, Bu, Ba);
+        Emu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Abi, Di), 62);
+        Be = ROL(XOR(Ago, Do), 55);
+        Bi = ROL(XOR(Aku, Du), 39);
+        Bo = ROL(XOR(Ama, Da), 41);
+        Bu = ROL(XOR(Ase, De), 2);
+        Esa = CHI(Ba, Be, Bi);
+        Ese = CHI(Be, Bi, Bo);
+        Esi = CHI(Bi, Bo, Bu);
+        Eso = CHI(Bo, Bu, Ba);
+        Esu = CHI(Bu, Ba, Be);
+
+
+        /* Round (round + 1): Exx -> Axx */
+
+        Ba = XOR5(Eba, Ega, Eka, Ema, Esa);
+        Be = XOR5(Ebe, Ege, Eke, Eme, Ese);
+        Bi = XOR5(Ebi, Egi, Eki, Emi, Esi);
+        Bo = XOR5(Ebo, Ego, Eko, Emo, Eso);
+        Bu = XOR5(Ebu, Egu, Eku, Emu, Esu);
+
+        Da = XOR(Bu, ROL(Be, 1));
+        De = XOR(Ba, ROL(Bi, 1));
+        Di = XOR(Be, ROL(Bo, 1));
+        Do = XOR(Bi, ROL(Bu, 1));
+        Du = XOR(Bo, ROL(Ba, 1));
+
+        Ba = XOR(Eba, Da);
+        Be = ROL(XOR(Ege, De), 44);
+        Bi = ROL(XOR(Eki, Di), 43);
+        Bo = ROL(XOR(Emo, Do), 21);
+        Bu = ROL(XOR(Esu, Du), 14);
+        Aba = XOR(CHI(Ba, Be, Bi), BROADCAST(round_constants[round + 1]));
+        Abe = CHI(Be, Bi, Bo);
+        Abi = CHI(Bi, Bo, Bu);
+        Abo = CHI(Bo, Bu, Ba);
+        Abu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Ebo, Do), 28);
+        Be = ROL(XOR(Egu, Du), 20);
+        Bi = ROL(XOR(Eka, Da), 3);
+        Bo = ROL(XOR(Eme, De), 45);
+        Bu = ROL(XOR(Esi, Di), 61);
+        Aga = CHI(Ba, Be, Bi);
+        Age = CHI(Be, Bi, Bo);
+        Agi = CHI(Bi, Bo, Bu);
+        Ago = CHI(Bo, Bu, Ba);
+        Agu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Ebe, De), 1);
+        Be = ROL(XOR(Egi, Di), 6);
+        Bi = ROL(XOR(Eko, Do), 25);
+        Bo = ROL(XOR(Emu, Du), 8);
+        Bu = ROL(XOR(Esa, Da), 18);
+        Aka = CHI(Ba, Be, Bi);
+        Ake = CHI(Be, Bi, Bo);
+        Aki = CHI(Bi, Bo, Bu);
+        Ako = CHI(Bo, Bu, Ba);
+        Aku = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Ebu, Du), 27);
+        Be = ROL(XOR(Ega, Da), 36);
+        Bi = ROL(XOR(Eke, De), 10);
+        Bo = ROL(XOR(Emi, Di), 15);
+        Bu = ROL(XOR(Eso, Do), 56);
+        Ama = CHI(Ba, Be, Bi);
+        Ame = CHI(Be, Bi, Bo);
+        Ami = CHI(Bi, Bo, Bu);
+        Amo = CHI(Bo, Bu, Ba);
+        Amu = CHI(Bu, Ba, Be);
+
+        Ba = ROL(XOR(Ebi, Di), 62);
+        Be = ROL(XOR(Ego, Do), 55);
+        Bi = ROL(XOR(Eku, Du), 39);
+        Bo = ROL(XOR(Ema, Da), 41);
+        Bu = ROL(XOR(Ese, De), 2);
+        Asa = CHI(Ba, Be, Bi);
+        Ase = CHI(Be, Bi, Bo);
+        Asi = CHI(Bi, Bo, Bu);
+        Aso = CHI(Bo, Bu, Ba);
+        Asu = CHI(Bu, Ba, Be);
+    }
+
+    STORE(state, 0, Aba);
+    STORE(state, 1, Abe);
+    STORE(state, 2, Abi);
+    STORE(state, 3, Abo);
+    STORE(state, 4, Abu);
+    STORE(state, 5, Aga);
+    STORE(state, 6, Age);
+    STORE(state, 7, Agi);
+    STORE(state, 8, Ago);
+    STORE(state, 9, Agu);
+    STORE(state, 10, Aka);
+    STORE(state, 11, Ake);
+    STORE(state, 12, Aki);
+    STORE(state, 13, Ako);
+    STORE(state, 14, Aku);
+    STORE(state, 15, Ama);
+    STORE(state, 16, Ame);
+    STORE(state, 17, Ami);
+    STORE(state, 18, Amo);
+    STORE(state, 19, Amu);
+    STORE(state, 20, Asa);
+    STORE(state, 21, Ase);
+    STORE(state, 22, Asi);
+    STORE(state, 23, Aso);
+    STORE(state, 24, Asu);
+}
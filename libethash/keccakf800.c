@@ -251,3 +251,62 @@ void ethash_keccakf800(uint32_t state[25])
     state[23] = Aso;
     state[24] = Asu;
 }
+
+#if ETHASH_X86_SIMD
+void ethash_keccakf800x8_avx2(uint32_t states[8 * 25]);
+void ethash_keccakf800x16_avx512(uint32_t states[16 * 25]);
+#endif
+
+/** Applies the scalar permutation to each of the interleaved states one by one. */
+static void keccakf800_multi_scalar(uint32_t* states, int num_states)
+{
+    uint32_t state[25];
+    int i, j;
+    for (j = 0; j < num_states; ++j)
+    {
+        for (i = 0; i < 25; ++i)
+            state[i] = states[i * num_states + j];
+        ethash_keccakf800(state);
+        for (i = 0; i < 25; ++i)
+            states[i * num_states + j] = state[i];
+    }
+}
+
+void ethash_keccakf800x8(uint32_t states[8 * 25])
+{
+#if ETHASH_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+    {
+        ethash_keccakf800x8_avx2(states);
+        return;
+    }
+#endif
+    keccakf800_multi_scalar(states, 8);
+}
+
+void ethash_keccakf800x16(uint32_t states[16 * 25])
+{
+#if ETHASH_X86_SIMD
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        ethash_keccakf800x16_avx512(states);
+        return;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        /* Split into two 8-way halves. */
+        uint32_t halves[2][8 * 25];
+        int i, j;
+        for (i = 0; i < 25; ++i)
+            for (j = 0; j < 16; ++j)
+                halves[j / 8][i * 8 + j % 8] = states[i * 16 + j];
+        ethash_keccakf800x8_avx2(halves[0]);
+        ethash_keccakf800x8_avx2(halves[1]);
+        for (i = 0; i < 25; ++i)
+            for (j = 0; j < 16; ++j)
+                states[i * 16 + j] = halves[j / 8][i * 8 + j % 8];
+        return;
+    }
+#endif
+    keccakf800_multi_scalar(states, 16);
+}
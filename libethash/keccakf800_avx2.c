@@ -0,0 +1,24 @@
+/* ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+ * Copyright 2018 Pawel Bylica.
+ * Licensed under the Apache License, Version 2.0. See the LICENSE file.
+ */
+
+/* This file must be compiled with AVX2 enabled. The caller checks the CPU supports it. */
+
+#include <immintrin.h>
+
+#define VEC __m256i
+#define LOAD(s, i) _mm256_loadu_si256((const __m256i*)&(s)[(i)*8])
+#define STORE(s, i, v) _mm256_storeu_si256((__m256i*)&(s)[(i)*8], (v))
+#define BROADCAST(x) _mm256_set1_epi32((int)(x))
+#define XOR(a, b) _mm256_xor_si256((a), (b))
+#define XOR5(a, b, c, d, e) XOR(XOR(XOR(a, b), XOR(c, d)), e)
+#define ROL(a, s) _mm256_or_si256(_mm256_slli_epi32((a), (s)), _mm256_srli_epi32((a), 32 - (s)))
+#define CHI(a, b, c) XOR((a), _mm256_andnot_si256((b), (c)))
+
+#include "keccakf800_multi.h"
+
+void ethash_keccakf800x8_avx2(uint32_t states[8 * 25])
+{
+    keccakf800_multi(states);
+}
@@ -4,8 +4,18 @@
 
 #include "ethash-internal.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #if !defined(__has_cpp_attribute)
 #define __has_cpp_attribute(x) 0
@@ -23,60 +33,183 @@ namespace ethash
 {
 namespace
 {
-std::mutex shared_context_mutex;
-std::shared_ptr<epoch_context> shared_context;
+/// Shared contexts kept for reuse, the most recently used first.
+template <typename Context>
+struct lru_cache
+{
+    std::mutex mutex;
+    std::list<std::shared_ptr<Context>> contexts;
+};
+
+lru_cache<epoch_context> shared_contexts;
 thread_local std::shared_ptr<epoch_context> thread_local_context;
 
-std::mutex shared_context_full_mutex;
-std::shared_ptr<epoch_context_full> shared_context_full;
+/// The shared contexts with full dataset are replicated per NUMA node.
+constexpr int max_numa_nodes = 64;
+lru_cache<epoch_context_full> shared_contexts_full[max_numa_nodes];
 thread_local std::shared_ptr<epoch_context_full> thread_local_context_full;
 
+std::atomic<unsigned> max_light_contexts{epoch_cache_limits{}.max_light};
+std::atomic<unsigned> max_full_contexts{epoch_cache_limits{}.max_full};
+std::atomic<uint64_t> max_cache_bytes{epoch_cache_limits{}.max_bytes};
+
+std::atomic<uint64_t> cache_bytes{0};
+std::atomic<uint64_t> cache_hits{0};
+std::atomic<uint64_t> cache_misses{0};
+std::atomic<uint64_t> cache_evictions{0};
+
+/// The last epoch written to the on-disk cache, so the replicas do not write it again.
+std::atomic<int> stored_epoch_full{-1};
+
+std::mutex prebuild_mutex;
+prebuild_options prebuild_settings;
+int prebuild_epoch = -1;
+
+/// The contexts of the next epoch built in the background, taken over at the epoch boundary.
+/// The build holds prebuild_context_mutex, so the threads reaching the boundary before it ends
+/// wait for it instead of building the same context again.
+std::mutex prebuild_context_mutex;
+std::shared_ptr<epoch_context> prebuilt_context;
+std::shared_ptr<epoch_context_full> prebuilt_context_full;
+
+/// Maps the context from the on-disk cache or builds a new one and caches it.
+std::shared_ptr<epoch_context> make_context(int epoch_number)
+{
+    std::shared_ptr<epoch_context> context = load_epoch_context(epoch_number);
+    if (!context)
+    {
+        context = create_epoch_context(epoch_number);
+        store_epoch_context(context);
+    }
+    return context;
+}
+
+/// Maps the context with the complete full dataset from the on-disk cache or creates a new one.
+std::shared_ptr<epoch_context_full> make_context_full(
+    int epoch_number, const build_options* options)
+{
+    std::shared_ptr<epoch_context_full> context = load_epoch_context_full(epoch_number);
+    if (!context)
+    {
+        // Build new context.
+        context = create_epoch_context_full(epoch_number);
+
+        // Generate the full dataset before any thread gets hold of the context
+        // and cache it once complete.
+        if (context && options && build_full_dataset(*context, *options) &&
+            stored_epoch_full.exchange(epoch_number) != epoch_number)
+            store_epoch_context_full(context);
+    }
+    return context;
+}
+
+/// Takes the prebuilt context of the epoch, waiting for its build to end.
+template <typename Context>
+std::shared_ptr<Context> take_prebuilt(std::shared_ptr<Context>& prebuilt, int epoch_number)
+{
+    std::lock_guard<std::mutex> lock{prebuild_context_mutex};
+    if (!prebuilt || prebuilt->epoch_number != epoch_number)
+        return {};
+    return std::move(prebuilt);
+}
+
+/// The memory taken by the contexts of an epoch.
+uint64_t context_size(int epoch_number, bool full) noexcept
+{
+    uint64_t size = get_light_cache_size(calculate_light_cache_num_items(epoch_number));
+    if (full)
+        size += get_full_dataset_size(calculate_full_dataset_num_items(epoch_number));
+    return size;
+}
+
+/// Returns the context of the epoch from the cache, or makes it after evicting the least
+/// recently used contexts over the limits so their memory is released first.
+template <typename Context, typename MakeFn>
+std::shared_ptr<Context> get_cached(
+    lru_cache<Context>& cache, int epoch_number, bool full, unsigned max_count, MakeFn make)
+{
+    auto& contexts = cache.contexts;
+    for (auto it = contexts.begin(); it != contexts.end(); ++it)
+    {
+        if ((*it)->epoch_number == epoch_number)
+        {
+            contexts.splice(contexts.begin(), contexts, it);
+            cache_hits.fetch_add(1, std::memory_order_relaxed);
+            return contexts.front();
+        }
+    }
+    cache_misses.fetch_add(1, std::memory_order_relaxed);
+
+    const uint64_t size = context_size(epoch_number, full);
+    const uint64_t max_bytes = max_cache_bytes.load(std::memory_order_relaxed);
+    while (!contexts.empty() &&
+           (contexts.size() >= std::max(max_count, 1u) ||
+               (max_bytes != 0 && cache_bytes.load(std::memory_order_relaxed) + size > max_bytes)))
+    {
+        cache_bytes.fetch_sub(context_size(contexts.back()->epoch_number, full));
+        contexts.pop_back();
+        cache_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<Context> context = make();
+    if (context)
+    {
+        contexts.push_front(context);
+        cache_bytes.fetch_add(size);
+    }
+    return context;
+}
+
+void prebuild(int epoch_number, prebuild_options options)
+{
+#if defined(__linux__)
+    // Nice the thread, the threads of the full dataset build inherit it.
+    ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+#endif
+
+    std::lock_guard<std::mutex> lock{prebuild_context_mutex};
+    prebuilt_context = make_context(epoch_number);
+    if (options.full)
+        prebuilt_context_full = make_context_full(epoch_number, &options.build);
+}
+
 /// Update thread local epoch context.
 ///
 /// This function is on the slow path. It's separated to allow inlining the fast
 /// path.
-///
-/// @todo: Redesign to guarantee deallocation before new allocation.
 ATTRIBUTE_NOINLINE
 void update_local_context(int epoch_number)
 {
     // Release the shared pointer of the obsoleted context.
     thread_local_context.reset();
 
-    // Local context invalid, check the shared context.
-    std::lock_guard<std::mutex> lock{shared_context_mutex};
-
-    if (!shared_context || shared_context->epoch_number != epoch_number)
-    {
-        // Release the shared pointer of the obsoleted context.
-        shared_context.reset();
-
-        // Build new context.
-        shared_context = create_epoch_context(epoch_number);
-    }
-
-    thread_local_context = shared_context;
+    // Local context invalid, check the shared contexts.
+    std::lock_guard<std::mutex> lock{shared_contexts.mutex};
+    thread_local_context = get_cached(shared_contexts, epoch_number, false,
+        max_light_contexts.load(std::memory_order_relaxed), [epoch_number] {
+            std::shared_ptr<epoch_context> context = take_prebuilt(prebuilt_context, epoch_number);
+            return context ? context : make_context(epoch_number);
+        });
 }
 
 ATTRIBUTE_NOINLINE
-void update_local_context_full(int epoch_number)
+void update_local_context_full(int epoch_number, const build_options* options, int numa_node)
 {
     // Release the shared pointer of the obsoleted context.
     thread_local_context_full.reset();
 
-    // Local context invalid, check the shared context.
-    std::lock_guard<std::mutex> lock{shared_context_full_mutex};
-
-    if (!shared_context_full || shared_context_full->epoch_number != epoch_number)
-    {
-        // Release the shared pointer of the obsoleted context.
-        shared_context_full.reset();
-
-        // Build new context.
-        shared_context_full = create_epoch_context_full(epoch_number);
-    }
-
-    thread_local_context_full = shared_context_full;
+    // Local context invalid, check the shared contexts of the node.
+    if (numa_node < 0 || numa_node >= max_numa_nodes)
+        numa_node = 0;
+    lru_cache<epoch_context_full>& shared = shared_contexts_full[numa_node];
+    std::lock_guard<std::mutex> lock{shared.mutex};
+    thread_local_context_full = get_cached(shared, epoch_number, true,
+        max_full_contexts.load(std::memory_order_relaxed), [epoch_number, options] {
+            // The context prebuilt in the background serves the first node asking for it.
+            std::shared_ptr<epoch_context_full> context =
+                take_prebuilt(prebuilt_context_full, epoch_number);
+            return context ? context : make_context_full(epoch_number, options);
+        });
 }
 }  // namespace
 
@@ -93,8 +226,84 @@ const epoch_context_full& get_global_epoch_context_full(int epoch_number)
 {
     // Check if local context matches epoch number.
     if (!thread_local_context_full || thread_local_context_full->epoch_number != epoch_number)
-        update_local_context_full(epoch_number);
+        update_local_context_full(epoch_number, nullptr, 0);
 
     return *thread_local_context_full;
 }
+
+const epoch_context_full& get_global_epoch_context_full(
+    int epoch_number, const build_options& options)
+{
+    // Check if local context matches epoch number.
+    if (!thread_local_context_full || thread_local_context_full->epoch_number != epoch_number)
+        update_local_context_full(epoch_number, &options, 0);
+
+    return *thread_local_context_full;
+}
+
+const epoch_context_full& get_numa_epoch_context_full(
+    int epoch_number, int numa_node, const build_options& options)
+{
+    // Check if local context matches epoch number.
+    if (!thread_local_context_full || thread_local_context_full->epoch_number != epoch_number)
+        update_local_context_full(epoch_number, &options, numa_node);
+
+    return *thread_local_context_full;
+}
+
+void set_prebuild_options(const prebuild_options& options)
+{
+    std::lock_guard<std::mutex> lock{prebuild_mutex};
+    prebuild_settings = options;
+}
+
+void prebuild_epoch_contexts(int block_number)
+{
+    if (block_number < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock{prebuild_mutex};
+    const prebuild_options& options = prebuild_settings;
+
+    const int epoch_number = get_epoch_number(block_number) + 1;
+    if (prebuild_epoch >= epoch_number ||
+        block_number < epoch_number * int64_t{epoch_length} - options.blocks_ahead)
+        return;
+
+    // Holding the contexts of both epochs must fit the budget, otherwise the contexts of the
+    // next epoch are built at the boundary in place of the current ones.
+    const uint64_t size = context_size(epoch_number - 1, options.full) +
+                          context_size(epoch_number, options.full);
+    if (size > options.memory_budget)
+        return;
+
+    prebuild_epoch = epoch_number;
+    std::thread{prebuild, epoch_number, options}.detach();
+}
+
+void set_epoch_cache_limits(const epoch_cache_limits& limits) noexcept
+{
+    max_light_contexts.store(limits.max_light, std::memory_order_relaxed);
+    max_full_contexts.store(limits.max_full, std::memory_order_relaxed);
+    max_cache_bytes.store(limits.max_bytes, std::memory_order_relaxed);
+}
+
+epoch_cache_stats get_epoch_cache_stats()
+{
+    epoch_cache_stats stats;
+    stats.hits = cache_hits.load(std::memory_order_relaxed);
+    stats.misses = cache_misses.load(std::memory_order_relaxed);
+    stats.evictions = cache_evictions.load(std::memory_order_relaxed);
+    stats.bytes = cache_bytes.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock{shared_contexts.mutex};
+        stats.light_contexts = static_cast<unsigned>(shared_contexts.contexts.size());
+    }
+    for (auto& shared : shared_contexts_full)
+    {
+        std::lock_guard<std::mutex> lock{shared.mutex};
+        stats.full_contexts += static_cast<unsigned>(shared.contexts.size());
+    }
+    return stats;
+}
 }  // namespace ethash
@@ -0,0 +1,206 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+/// @file
+/// The memory of the epoch contexts.
+///
+/// The full dataset is read at random, so with 4 KB pages nearly every access misses the TLB.
+/// The contexts are allocated from the largest pages the system gives: explicit 1 GB or 2 MB
+/// huge pages (hugetlbfs, reserved by the administrator), then transparent huge pages,
+/// then normal pages.
+
+#include "ethash-internal.hpp"
+
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ETHASH_MMAP 1
+#include <sys/mman.h>
+#else
+#define ETHASH_MMAP 0
+#endif
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace ethash
+{
+namespace
+{
+struct allocation
+{
+    size_t size;
+    memory_mode mode;
+};
+
+std::mutex allocations_mutex;
+std::unordered_map<const void*, allocation> allocations;
+
+std::atomic<memory_mode> max_memory_mode{memory_mode::huge_pages_1gb};
+
+constexpr size_t huge_page_2mb = size_t{1} << 21;
+constexpr size_t huge_page_1gb = size_t{1} << 30;
+
+inline size_t round_up(size_t size, size_t alignment) noexcept
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/// Huge pages are only worth it when rounding the size up to them wastes at most 1/8 of it.
+inline bool fits_pages(size_t size, size_t page_size) noexcept
+{
+    return round_up(size, page_size) - size <= size / 8;
+}
+
+#if ETHASH_MMAP
+void* map_anonymous(size_t size, int flags) noexcept
+{
+    void* p =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return p != MAP_FAILED ? p : nullptr;
+}
+
+void* allocate(size_t& size, memory_mode& mode) noexcept
+{
+    const memory_mode max_mode = max_memory_mode.load(std::memory_order_relaxed);
+
+#if defined(MAP_HUGETLB)
+    if (max_mode >= memory_mode::huge_pages_1gb && fits_pages(size, huge_page_1gb))
+    {
+        const size_t rounded_size = round_up(size, huge_page_1gb);
+        if (void* p = map_anonymous(rounded_size, MAP_HUGETLB | (30 << MAP_HUGE_SHIFT)))
+        {
+            size = rounded_size;
+            mode = memory_mode::huge_pages_1gb;
+            return p;
+        }
+    }
+
+    if (max_mode >= memory_mode::huge_pages_2mb && fits_pages(size, huge_page_2mb))
+    {
+        const size_t rounded_size = round_up(size, huge_page_2mb);
+        if (void* p = map_anonymous(rounded_size, MAP_HUGETLB | (21 << MAP_HUGE_SHIFT)))
+        {
+            size = rounded_size;
+            mode = memory_mode::huge_pages_2mb;
+            return p;
+        }
+    }
+#endif
+
+#if defined(MADV_HUGEPAGE)
+    if (max_mode >= memory_mode::transparent_huge_pages && fits_pages(size, huge_page_2mb))
+    {
+        // Over-allocate to cut out a region aligned to 2 MB, the kernel only backs
+        // the aligned parts with huge pages.
+        const size_t rounded_size = round_up(size, huge_page_2mb);
+        if (char* p = static_cast<char*>(map_anonymous(rounded_size + huge_page_2mb, 0)))
+        {
+            char* const aligned = reinterpret_cast<char*>(
+                round_up(reinterpret_cast<uintptr_t>(p), huge_page_2mb));
+            if (aligned != p)
+                ::munmap(p, static_cast<size_t>(aligned - p));
+            if (aligned + rounded_size != p + rounded_size + huge_page_2mb)
+                ::munmap(aligned + rounded_size,
+                    static_cast<size_t>(p + huge_page_2mb - aligned));
+
+            size = rounded_size;
+            mode = ::madvise(aligned, rounded_size, MADV_HUGEPAGE) == 0 ?
+                       memory_mode::transparent_huge_pages :
+                       memory_mode::normal_pages;
+            return aligned;
+        }
+    }
+#endif
+
+    mode = memory_mode::normal_pages;
+    return map_anonymous(size, 0);
+}
+
+void release(void* p, const allocation& a) noexcept
+{
+    ::munmap(p, a.size);
+}
+#else
+void* allocate(size_t& size, memory_mode& mode) noexcept
+{
+    mode = memory_mode::normal_pages;
+    return std::calloc(1, size);
+}
+
+void release(void* p, const allocation&) noexcept
+{
+    std::free(p);
+}
+#endif
+}  // namespace
+
+void set_max_memory_mode(memory_mode mode) noexcept
+{
+    max_memory_mode.store(
+        mode == memory_mode::file_mapping ? memory_mode::huge_pages_1gb : mode,
+        std::memory_order_relaxed);
+}
+
+memory_mode get_memory_mode(const epoch_context& context) noexcept
+{
+    std::lock_guard<std::mutex> lock{allocations_mutex};
+    const auto it = allocations.find(&context);
+    return it != allocations.end() ? it->second.mode : memory_mode::normal_pages;
+}
+
+memory_mode get_memory_mode(const epoch_context_full& context) noexcept
+{
+    return get_memory_mode(static_cast<const epoch_context&>(context));
+}
+
+const char* to_string(memory_mode mode) noexcept
+{
+    switch (mode)
+    {
+    case memory_mode::normal_pages:
+        return "normal pages";
+    case memory_mode::transparent_huge_pages:
+        return "transparent huge pages";
+    case memory_mode::huge_pages_2mb:
+        return "2 MB huge pages";
+    case memory_mode::huge_pages_1gb:
+        return "1 GB huge pages";
+    case memory_mode::file_mapping:
+        return "file mapping";
+    }
+    return "unknown";
+}
+
+void* allocate_context_memory(size_t size, memory_mode& mode) noexcept
+{
+    void* p = allocate(size, mode);
+    if (p)
+        register_context_memory(p, size, mode);
+    return p;
+}
+
+void register_context_memory(void* p, size_t size, memory_mode mode) noexcept
+{
+    std::lock_guard<std::mutex> lock{allocations_mutex};
+    allocations[p] = {size, mode};
+}
+
+void free_context_memory(void* p) noexcept
+{
+    allocation a{};
+    {
+        std::lock_guard<std::mutex> lock{allocations_mutex};
+        const auto it = allocations.find(p);
+        if (it == allocations.end())
+            return;
+        a = it->second;
+        allocations.erase(it);
+    }
+    release(p, a);
+}
+}  // namespace ethash
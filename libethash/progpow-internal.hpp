@@ -0,0 +1,87 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+/// @file
+/// Contains declarations of internal ProgPoW functions shared by the portable implementation
+/// and the SIMD round engines.
+
+#pragma once
+
+#include <ethash/progpow.hpp>
+
+#include <memory>
+
+namespace progpow
+{
+using lookup_fn = hash2048 (*)(const epoch_context&, uint32_t);
+
+class item_cache;
+
+/// Selects the dataset lookup of the light hashing of the context: through the item cache
+/// of the epoch when enabled (see set_item_cache_size()), otherwise computing the items.
+/// The cache is bound to the calling thread for the lifetime of the object.
+class light_lookup
+{
+public:
+    explicit light_lookup(const epoch_context& context) noexcept;
+    ~light_lookup();
+
+    light_lookup(const light_lookup&) = delete;
+    light_lookup& operator=(const light_lookup&) = delete;
+
+    lookup_fn get() const noexcept;
+
+private:
+    std::shared_ptr<item_cache> cache;
+    item_cache* previous;
+};
+
+/// The number of the words of a dataset item merged into every lane in a round.
+constexpr size_t num_words_per_lane = sizeof(hash2048) / (sizeof(uint32_t) * num_lanes);
+
+/// The number of the random operations of a round.
+constexpr int max_operations =
+    num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+
+/// The operations of a ProgPoW round.
+///
+/// Every round starts from the same mix RNG state, so the same operations are executed
+/// in all the rounds of a period. The i-th cache access is followed by the i-th math operation.
+struct round_program
+{
+    struct cache_access
+    {
+        uint32_t src;
+        uint32_t dst;
+        uint32_t sel;
+    };
+
+    struct math_operation
+    {
+        uint32_t src1;
+        uint32_t src2;
+        uint32_t sel1;
+        uint32_t dst;
+        uint32_t sel2;
+    };
+
+    cache_access cache_accesses[num_cache_accesses];
+    math_operation math_operations[num_math_operations];
+    uint32_t dag_dsts[num_words_per_lane];
+    uint32_t dag_sels[num_words_per_lane];
+};
+
+/// The mix in the structure-of-arrays layout: the register r of the lane l is mix[r][l].
+using mix_soa = uint32_t[num_regs][num_lanes];
+
+/// Executes the 64 rounds of the ProgPoW mix on the structure-of-arrays mix using SIMD
+/// instructions. The caller checks the CPU supports the ISA extensions.
+using rounds_fn = void (*)(
+    const epoch_context& context, mix_soa& mix, const round_program& program, lookup_fn lookup);
+
+void rounds_avx2(const epoch_context& context, mix_soa& mix, const round_program& program,
+    lookup_fn lookup) noexcept;
+void rounds_avx512(const epoch_context& context, mix_soa& mix, const round_program& program,
+    lookup_fn lookup) noexcept;
+}  // namespace progpow
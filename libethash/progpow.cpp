@@ -8,9 +8,12 @@
 #include "endianness.hpp"
 #include "ethash-internal.hpp"
 #include "kiss99.hpp"
+#include "progpow-internal.hpp"
 #include <ethash/keccak.hpp>
 
 #include <array>
+#include <atomic>
+#include <mutex>
 
 namespace progpow
 {
@@ -59,6 +62,42 @@ inline uint64_t keccak_progpow_64(const hash256& header_hash, uint64_t nonce) no
     return be::uint64(h.word64s[0]);
 }
 
+/// The number of nonces hashed together by search functions.
+constexpr size_t search_batch_size = 16;
+
+/// Computes keccak_progpow_256() of search_batch_size inputs sharing the header hash
+/// with the multi-buffer Keccak-f[800].
+void keccak_progpow_256x16(hash256 out[search_batch_size], const hash256& header_hash,
+    const uint64_t nonces[search_batch_size], const hash256 mix_hashes[search_batch_size]) noexcept
+{
+    static constexpr size_t n = search_batch_size;
+    static constexpr size_t num_words =
+        sizeof(header_hash.word32s) / sizeof(header_hash.word32s[0]);
+
+    uint32_t states[25 * n] = {};
+
+    for (size_t j = 0; j < n; ++j)
+    {
+        size_t i;
+        for (i = 0; i < num_words; ++i)
+            states[i * n + j] = le::uint32(header_hash.word32s[i]);
+
+        states[i++ * n + j] = static_cast<uint32_t>(nonces[j]);
+        states[i++ * n + j] = static_cast<uint32_t>(nonces[j] >> 32);
+
+        for (uint32_t mix_word : mix_hashes[j].word32s)
+            states[i++ * n + j] = le::uint32(mix_word);
+    }
+
+    ethash_keccakf800x16(states);
+
+    for (size_t j = 0; j < n; ++j)
+    {
+        for (size_t i = 0; i < num_words; ++i)
+            out[j].word32s[i] = le::uint32(states[i * n + j]);
+    }
+}
+
 
 /// ProgPoW mix RNG state.
 ///
@@ -144,125 +183,294 @@ inline uint32_t random_math(uint32_t a, uint32_t b, uint32_t selector) noexcept
 /// Merge data from `b` and `a`.
 /// Assuming `a` has high entropy, only do ops that retain entropy even if `b`
 /// has low entropy (i.e. do not do `a & b`).
+///
+/// The merge operation is selected by `selector % 4`. The additional non-zero selector
+/// from higher bits `x` is used by the rotations.
+template <uint32_t Kind>
 NO_SANITIZE("unsigned-integer-overflow")
-inline void random_merge(uint32_t& a, uint32_t b, uint32_t selector) noexcept
+inline uint32_t random_merge(uint32_t a, uint32_t b, uint32_t x) noexcept
 {
-    const auto x = (selector >> 16) % 31 + 1;  // Additional non-zero selector from higher bits.
-    switch (selector % 4)
+    switch (Kind)
     {
+    default:
     case 0:
-        a = (a * 33) + b;
-        break;
+        return (a * 33) + b;
     case 1:
-        a = (a ^ b) * 33;
-        break;
+        return (a ^ b) * 33;
     case 2:
-        a = rotl32(a, x) ^ b;
-        break;
+        return rotl32(a, x) ^ b;
     case 3:
-        a = rotr32(a, x) ^ b;
-        break;
+        return rotr32(a, x) ^ b;
     }
 }
 
-using lookup_fn = hash2048 (*)(const epoch_context&, uint32_t);
+/// A register of all the lanes.
+using lanes = uint32_t[num_lanes];
 
-using mix_array = std::array<std::array<uint32_t, num_regs>, num_lanes>;
+/// Applies random_math() with the given selector to all the lanes.
+using math_handler = void (*)(lanes& out, const lanes& a, const lanes& b);
 
-void round(
-    const epoch_context& context, uint32_t r, mix_array& mix, mix_rng_state state, lookup_fn lookup)
+/// Applies random_merge() of the given kind to all the lanes.
+using merge_handler = void (*)(lanes& a, const lanes& b, uint32_t x);
+
+template <uint32_t Selector>
+void math_lanes(lanes& out, const lanes& a, const lanes& b) noexcept
 {
-    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
-    const uint32_t item_index = mix[r % num_lanes][0] % num_items;
-    const hash2048 item = lookup(context, item_index);
+    for (size_t l = 0; l < num_lanes; ++l)
+        out[l] = random_math(a[l], b[l], Selector);
+}
 
-    constexpr size_t num_words_per_lane = sizeof(item) / (sizeof(uint32_t) * num_lanes);
-    constexpr int max_operations =
-        num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+template <uint32_t Kind>
+void merge_lanes(lanes& a, const lanes& b, uint32_t x) noexcept
+{
+    for (size_t l = 0; l < num_lanes; ++l)
+        a[l] = random_merge<Kind>(a[l], b[l], x);
+}
+
+constexpr math_handler math_handlers[] = {math_lanes<0>, math_lanes<1>, math_lanes<2>,
+    math_lanes<3>, math_lanes<4>, math_lanes<5>, math_lanes<6>, math_lanes<7>, math_lanes<8>,
+    math_lanes<9>, math_lanes<10>};
+
+constexpr merge_handler merge_handlers[] = {
+    merge_lanes<0>, merge_lanes<1>, merge_lanes<2>, merge_lanes<3>};
+
+/// The merge with the handler and the additional selector resolved.
+struct merge_step
+{
+    merge_handler handler;
+    uint32_t x;
+};
+
+inline merge_step decode_merge(uint32_t selector) noexcept
+{
+    return {merge_handlers[selector % 4], (selector >> 16) % 31 + 1};
+}
+
+/// The ProgPoW program of a period.
+///
+/// The operations of a round are drawn from the mix RNG state of the period. Every round
+/// starts from the same state, so the operations are decoded once: the register indexes
+/// and selectors for the SIMD engines and the resolved handlers for the portable round().
+struct program
+{
+    native_rounds_fn native_rounds;
+    round_program ops;
+    merge_step cache_merges[num_cache_accesses];
+    math_handler maths[num_math_operations];
+    merge_step math_merges[num_math_operations];
+    merge_step dag_merges[num_words_per_lane];
+};
+
+/// Records the operations of a round drawn from the given mix RNG state.
+round_program make_round_program(mix_rng_state state) noexcept
+{
+    round_program program;
 
-    // Process lanes.
     for (int i = 0; i < max_operations; ++i)
     {
         if (i < num_cache_accesses)  // Random access to cached memory.
         {
-            const auto src = state.next_src();
-            const auto dst = state.next_dst();
-            const auto sel = state.rng();
-
-            for (size_t l = 0; l < num_lanes; ++l)
-            {
-                const size_t offset = mix[l][src] % l1_cache_num_items;
-                random_merge(mix[l][dst], le::uint32(context.l1_cache[offset]), sel);
-            }
+            auto& op = program.cache_accesses[i];
+            op.src = state.next_src();
+            op.dst = state.next_dst();
+            op.sel = state.rng();
         }
         if (i < num_math_operations)  // Random math.
         {
+            auto& op = program.math_operations[i];
+
             // Generate 2 unique source indexes.
             const auto src_rnd = state.rng() % (num_regs * (num_regs - 1));
-            const auto src1 = src_rnd % num_regs;  // O <= src1 < num_regs
-            auto src2 = src_rnd / num_regs;        // 0 <= src2 < num_regs - 1
-            if (src2 >= src1)
-                ++src2;
-
-            const auto sel1 = state.rng();
-            const auto dst = state.next_dst();
-            const auto sel2 = state.rng();
-
-            for (size_t l = 0; l < num_lanes; ++l)
-            {
-                const uint32_t data = random_math(mix[l][src1], mix[l][src2], sel1);
-                random_merge(mix[l][dst], data, sel2);
-            }
+            op.src1 = src_rnd % num_regs;  // O <= src1 < num_regs
+            op.src2 = src_rnd / num_regs;  // 0 <= src2 < num_regs - 1
+            if (op.src2 >= op.src1)
+                ++op.src2;
+
+            op.sel1 = state.rng();
+            op.dst = state.next_dst();
+            op.sel2 = state.rng();
         }
     }
 
     // DAG access pattern.
-    uint32_t dsts[num_words_per_lane];
-    uint32_t sels[num_words_per_lane];
     for (size_t i = 0; i < num_words_per_lane; ++i)
     {
-        dsts[i] = i == 0 ? 0 : state.next_dst();
-        sels[i] = state.rng();
+        program.dag_dsts[i] = i == 0 ? 0 : state.next_dst();
+        program.dag_sels[i] = state.rng();
+    }
+    return program;
+}
+
+program decode_program(uint64_t period) noexcept
+{
+    program p;
+    p.native_rounds = nullptr;
+    p.ops = make_round_program(mix_rng_state{period});
+
+    for (int i = 0; i < num_cache_accesses; ++i)
+        p.cache_merges[i] = decode_merge(p.ops.cache_accesses[i].sel);
+
+    for (int i = 0; i < num_math_operations; ++i)
+    {
+        p.maths[i] = math_handlers[p.ops.math_operations[i].sel1 % 11];
+        p.math_merges[i] = decode_merge(p.ops.math_operations[i].sel2);
+    }
+
+    for (size_t i = 0; i < num_words_per_lane; ++i)
+        p.dag_merges[i] = decode_merge(p.ops.dag_sels[i]);
+    return p;
+}
+
+/// The native rounds registered with set_native_rounds().
+/// The version is bumped on every registration to invalidate the cached programs.
+std::mutex native_rounds_mutex;
+uint64_t native_rounds_period = 0;
+native_rounds_fn native_rounds = nullptr;
+std::atomic<unsigned> native_rounds_version{0};
+
+/// Returns the program of the period.
+/// The program changes every period_length blocks, so the last one is cached per thread.
+const program& get_program(uint64_t period) noexcept
+{
+    thread_local bool cached = false;
+    thread_local uint64_t cached_period;
+    thread_local unsigned cached_version;
+    thread_local program cached_program;
+
+    const unsigned version = native_rounds_version.load(std::memory_order_acquire);
+    if (!cached || cached_period != period || cached_version != version)
+    {
+        cached_program = decode_program(period);
+
+        std::lock_guard<std::mutex> lock{native_rounds_mutex};
+        if (native_rounds && native_rounds_period == period)
+            cached_program.native_rounds = native_rounds;
+
+        cached_period = period;
+        cached_version = version;
+        cached = true;
+    }
+    return cached_program;
+}
+
+void round(const epoch_context& context, uint32_t r, mix_soa& mix, const program& prog,
+    lookup_fn lookup) noexcept
+{
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+    const uint32_t item_index = mix[0][r % num_lanes] % num_items;
+    const hash2048 item = lookup(context, item_index);
+
+    // Process lanes.
+    for (int i = 0; i < max_operations; ++i)
+    {
+        if (i < num_cache_accesses)  // Random access to cached memory.
+        {
+            const auto& op = prog.ops.cache_accesses[i];
+            lanes data;
+            for (size_t l = 0; l < num_lanes; ++l)
+                data[l] = le::uint32(context.l1_cache[mix[op.src][l] % l1_cache_num_items]);
+
+            const auto& merge = prog.cache_merges[i];
+            merge.handler(mix[op.dst], data, merge.x);
+        }
+        if (i < num_math_operations)  // Random math.
+        {
+            const auto& op = prog.ops.math_operations[i];
+            lanes data;
+            prog.maths[i](data, mix[op.src1], mix[op.src2]);
+
+            const auto& merge = prog.math_merges[i];
+            merge.handler(mix[op.dst], data, merge.x);
+        }
     }
 
     // DAG access.
-    for (size_t l = 0; l < num_lanes; ++l)
+    for (size_t i = 0; i < num_words_per_lane; ++i)
     {
-        const auto offset = ((l ^ r) % num_lanes) * num_words_per_lane;
-        for (size_t i = 0; i < num_words_per_lane; ++i)
+        lanes words;
+        for (size_t l = 0; l < num_lanes; ++l)
         {
-            const auto word = le::uint32(item.word32s[offset + i]);
-            random_merge(mix[l][dsts[i]], word, sels[i]);
+            const auto offset = ((l ^ r) % num_lanes) * num_words_per_lane;
+            words[l] = le::uint32(item.word32s[offset + i]);
         }
+
+        const auto& merge = prog.dag_merges[i];
+        merge.handler(mix[prog.ops.dag_dsts[i]], words, merge.x);
     }
 }
 
-mix_array init_mix(uint64_t seed)
+/// Returns the SIMD round engine supported by the CPU, or null if there is none.
+rounds_fn select_simd_rounds() noexcept
+{
+#if ETHASH_X86_SIMD
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd") &&
+        __builtin_cpu_supports("avx512bw"))
+        return rounds_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return rounds_avx2;
+#endif
+    return nullptr;
+}
+
+void init_mix(mix_soa& mix, uint64_t seed) noexcept
 {
     const uint32_t z = fnv1a(fnv_offset_basis, static_cast<uint32_t>(seed));
     const uint32_t w = fnv1a(z, static_cast<uint32_t>(seed >> 32));
 
-    mix_array mix;
-    for (uint32_t l = 0; l < mix.size(); ++l)
+    for (uint32_t l = 0; l < num_lanes; ++l)
     {
         const uint32_t jsr = fnv1a(w, l);
         const uint32_t jcong = fnv1a(jsr, l);
         kiss99 rng{z, w, jsr, jcong};
 
-        for (auto& row : mix[l])
-            row = rng();
+        for (uint32_t i = 0; i < num_regs; ++i)
+            mix[i][l] = rng();
     }
-    return mix;
+}
+
+hash2048 lazy_lookup(const epoch_context& context, uint32_t index) noexcept
+{
+    return lazy_lookup_2048(static_cast<const epoch_context_full&>(context), index);
+}
+
+/// The lookup passed through the native rounds.
+struct native_lookup_context
+{
+    const epoch_context& context;
+    lookup_fn lookup;
+};
+
+void native_lookup(const void* lookup_context, uint32_t index, uint32_t* item) noexcept
+{
+    const auto& c = *static_cast<const native_lookup_context*>(lookup_context);
+    const hash2048 data = c.lookup(c.context, index);
+    for (size_t i = 0; i < sizeof(data) / sizeof(uint32_t); ++i)
+        item[i] = le::uint32(data.word32s[i]);
 }
 
 hash256 hash_mix(
     const epoch_context& context, int block_number, uint64_t seed, lookup_fn lookup) noexcept
 {
-    auto mix = init_mix(seed);
-    mix_rng_state state{uint64_t(block_number / period_length)};
+    static const rounds_fn simd_rounds = select_simd_rounds();
+
+    const program& prog = get_program(uint64_t(block_number / period_length));
+
+    mix_soa mix;
+    init_mix(mix, seed);
 
-    for (uint32_t i = 0; i < 64; ++i)
-        round(context, i, mix, state, lookup);
+    if (prog.native_rounds)
+    {
+        const native_lookup_context lookup_context{context, lookup};
+        const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+        prog.native_rounds(mix, context.l1_cache, num_items, native_lookup, &lookup_context);
+    }
+    else if (simd_rounds)
+        simd_rounds(context, mix, prog.ops, lookup);
+    else
+    {
+        for (uint32_t i = 0; i < 64; ++i)
+            round(context, i, mix, prog, lookup);
+    }
 
     // Reduce mix data to a single per-lane result.
     uint32_t lane_hash[num_lanes];
@@ -270,7 +478,7 @@ hash256 hash_mix(
     {
         lane_hash[l] = fnv_offset_basis;
         for (uint32_t i = 0; i < num_regs; ++i)
-            lane_hash[l] = fnv1a(lane_hash[l], mix[l][i]);
+            lane_hash[l] = fnv1a(lane_hash[l], mix[i][l]);
     }
 
     // Reduce all lanes to a single 256-bit result.
@@ -288,7 +496,8 @@ result hash(const epoch_context& context, int block_number, const hash256& heade
     uint64_t nonce) noexcept
 {
     const uint64_t seed = keccak_progpow_64(header_hash, nonce);
-    const hash256 mix_hash = hash_mix(context, block_number, seed, calculate_dataset_item_2048);
+    const light_lookup lookup{context};
+    const hash256 mix_hash = hash_mix(context, block_number, seed, lookup.get());
     const hash256 final_hash = keccak_progpow_256(header_hash, seed, mix_hash);
     return {final_hash, mix_hash};
 }
@@ -296,20 +505,6 @@ result hash(const epoch_context& context, int block_number, const hash256& heade
 result hash(const epoch_context_full& context, int block_number, const hash256& header_hash,
     uint64_t nonce) noexcept
 {
-    static const auto lazy_lookup = [](const epoch_context& context, uint32_t index) noexcept
-    {
-        auto* full_dataset_1024 = static_cast<const epoch_context_full&>(context).full_dataset;
-        auto* full_dataset_2048 = reinterpret_cast<hash2048*>(full_dataset_1024);
-        hash2048& item = full_dataset_2048[index];
-        if (item.word64s[0] == 0)
-        {
-            // TODO: Copy elision here makes it thread-safe?
-            item = calculate_dataset_item_2048(context, index);
-        }
-
-        return item;
-    };
-
     const uint64_t seed = keccak_progpow_64(header_hash, nonce);
     const hash256 mix_hash = hash_mix(context, block_number, seed, lazy_lookup);
     const hash256 final_hash = keccak_progpow_256(header_hash, seed, mix_hash);
@@ -324,37 +519,85 @@ bool verify(const epoch_context& context, int block_number, const hash256& heade
     if (!is_less_or_equal(final_hash, boundary))
         return false;
 
-    const hash256 expected_mix_hash =
-        hash_mix(context, block_number, seed, calculate_dataset_item_2048);
+    const light_lookup lookup{context};
+    const hash256 expected_mix_hash = hash_mix(context, block_number, seed, lookup.get());
     return is_equal(expected_mix_hash, mix_hash);
 }
 
-search_result search_light(const epoch_context& context, int block_number,
-    const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
-    size_t iterations) noexcept
+namespace
 {
-    const uint64_t end_nonce = start_nonce + iterations;
-    for (uint64_t nonce = start_nonce; nonce < end_nonce; ++nonce)
+/// Searches nonces in batches sharing the multi-buffer Keccak for the seed and final hashes.
+/// The results are the same as hashing the nonces one by one.
+search_result search_batched(const epoch_context& context, int block_number,
+    const hash256& header_hash, const hash256& boundary, uint64_t start_nonce, size_t iterations,
+    lookup_fn lookup) noexcept
+{
+    static constexpr hash256 null_mix_hashes[search_batch_size] = {};
+
+    size_t i = 0;
+    for (; iterations - i >= search_batch_size; i += search_batch_size)
     {
-        result r = hash(context, block_number, header_hash, nonce);
-        if (is_less_or_equal(r.final_hash, boundary))
-            return {r, nonce};
+        uint64_t nonces[search_batch_size];
+        for (size_t j = 0; j < search_batch_size; ++j)
+            nonces[j] = start_nonce + i + j;
+
+        hash256 seed_hashes[search_batch_size];
+        keccak_progpow_256x16(seed_hashes, header_hash, nonces, null_mix_hashes);
+
+        uint64_t seeds[search_batch_size];
+        hash256 mix_hashes[search_batch_size];
+        for (size_t j = 0; j < search_batch_size; ++j)
+        {
+            seeds[j] = be::uint64(seed_hashes[j].word64s[0]);
+            mix_hashes[j] = hash_mix(context, block_number, seeds[j], lookup);
+        }
+
+        hash256 final_hashes[search_batch_size];
+        keccak_progpow_256x16(final_hashes, header_hash, seeds, mix_hashes);
+
+        for (size_t j = 0; j < search_batch_size; ++j)
+        {
+            if (is_less_or_equal(final_hashes[j], boundary))
+                return {{final_hashes[j], mix_hashes[j]}, nonces[j]};
+        }
+    }
+
+    for (; i < iterations; ++i)
+    {
+        const uint64_t nonce = start_nonce + i;
+        const uint64_t seed = keccak_progpow_64(header_hash, nonce);
+        const hash256 mix_hash = hash_mix(context, block_number, seed, lookup);
+        const hash256 final_hash = keccak_progpow_256(header_hash, seed, mix_hash);
+        if (is_less_or_equal(final_hash, boundary))
+            return {{final_hash, mix_hash}, nonce};
     }
     return {};
 }
+}  // namespace
+
+void set_native_rounds(uint64_t period, native_rounds_fn rounds) noexcept
+{
+    std::lock_guard<std::mutex> lock{native_rounds_mutex};
+    native_rounds_period = period;
+    native_rounds = rounds;
+    native_rounds_version.fetch_add(1, std::memory_order_release);
+}
+
+search_result search_light(const epoch_context& context, int block_number,
+    const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
+    size_t iterations) noexcept
+{
+    const light_lookup lookup{context};
+    return search_batched(
+        context, block_number, header_hash, boundary, start_nonce, iterations, lookup.get());
+}
 
 search_result search(const epoch_context_full& context, int block_number,
     const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
     size_t iterations) noexcept
 {
-    const uint64_t end_nonce = start_nonce + iterations;
-    for (uint64_t nonce = start_nonce; nonce < end_nonce; ++nonce)
-    {
-        result r = hash(context, block_number, header_hash, nonce);
-        if (is_less_or_equal(r.final_hash, boundary))
-            return {r, nonce};
-    }
-    return {};
+    return search_batched(context, block_number, header_hash, boundary, start_nonce, iterations,
+        lazy_lookup);
 }
 
 }  // namespace progpow
@@ -0,0 +1,151 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+// This file must be compiled with AVX2 enabled. The caller checks the CPU supports it.
+
+#include "progpow_rounds.hpp"
+
+#include <immintrin.h>
+
+namespace progpow
+{
+namespace
+{
+/// The 16 lanes in two 256-bit vectors.
+struct vec_avx2
+{
+    __m256i lo;
+    __m256i hi;
+
+    static vec_avx2 load(const uint32_t* p) noexcept
+    {
+        return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 8))};
+    }
+
+    static void store(uint32_t* p, vec_avx2 a) noexcept
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 8), a.hi);
+    }
+
+    static vec_avx2 set1(uint32_t x) noexcept
+    {
+        const __m256i v = _mm256_set1_epi32(int(x));
+        return {v, v};
+    }
+
+    static vec_avx2 lane_ids() noexcept
+    {
+        return {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+            _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15)};
+    }
+
+    static vec_avx2 gather(const uint32_t* base, vec_avx2 indexes) noexcept
+    {
+        const auto p = reinterpret_cast<const int*>(base);
+        return {_mm256_i32gather_epi32(p, indexes.lo, 4), _mm256_i32gather_epi32(p, indexes.hi, 4)};
+    }
+
+    static vec_avx2 add(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_add_epi32(a.lo, b.lo), _mm256_add_epi32(a.hi, b.hi)};
+    }
+    static vec_avx2 mul(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_mullo_epi32(a.lo, b.lo), _mm256_mullo_epi32(a.hi, b.hi)};
+    }
+    static vec_avx2 min(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_min_epu32(a.lo, b.lo), _mm256_min_epu32(a.hi, b.hi)};
+    }
+    static vec_avx2 and_(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_and_si256(a.lo, b.lo), _mm256_and_si256(a.hi, b.hi)};
+    }
+    static vec_avx2 or_(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_or_si256(a.lo, b.lo), _mm256_or_si256(a.hi, b.hi)};
+    }
+    static vec_avx2 xor_(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {_mm256_xor_si256(a.lo, b.lo), _mm256_xor_si256(a.hi, b.hi)};
+    }
+
+    static vec_avx2 rotl(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {rotl(a.lo, b.lo), rotl(a.hi, b.hi)};
+    }
+    static vec_avx2 rotr(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {rotr(a.lo, b.lo), rotr(a.hi, b.hi)};
+    }
+    static vec_avx2 mul_hi(vec_avx2 a, vec_avx2 b) noexcept
+    {
+        return {mul_hi(a.lo, b.lo), mul_hi(a.hi, b.hi)};
+    }
+    static vec_avx2 clz(vec_avx2 a) noexcept { return {clz(a.lo), clz(a.hi)}; }
+    static vec_avx2 popcount(vec_avx2 a) noexcept { return {popcount(a.lo), popcount(a.hi)}; }
+
+private:
+    static __m256i rotl(__m256i a, __m256i b) noexcept
+    {
+        // The same as rotl32(): the shift counts are (b & 31) and (-b & 31).
+        const __m256i mask = _mm256_set1_epi32(31);
+        const __m256i c = _mm256_and_si256(b, mask);
+        const __m256i neg_c = _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), c), mask);
+        return _mm256_or_si256(_mm256_sllv_epi32(a, c), _mm256_srlv_epi32(a, neg_c));
+    }
+
+    static __m256i rotr(__m256i a, __m256i b) noexcept
+    {
+        const __m256i mask = _mm256_set1_epi32(31);
+        const __m256i c = _mm256_and_si256(b, mask);
+        const __m256i neg_c = _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), c), mask);
+        return _mm256_or_si256(_mm256_srlv_epi32(a, c), _mm256_sllv_epi32(a, neg_c));
+    }
+
+    static __m256i mul_hi(__m256i a, __m256i b) noexcept
+    {
+        // The high halves of the 64-bit products of the even and the odd lanes.
+        const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+        const __m256i odd =
+            _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+        return _mm256_blend_epi32(even, odd, 0xAA);
+    }
+
+    static __m256i clz(__m256i a) noexcept
+    {
+        // Clearing the bit below every set bit keeps the top bit and makes the conversion
+        // to float exact in the exponent: clz = 158 - exponent. The sign bit and zero
+        // are handled separately.
+        const __m256i y = _mm256_andnot_si256(_mm256_srli_epi32(a, 1), a);
+        const __m256i bits = _mm256_castps_si256(_mm256_cvtepi32_ps(y));
+        const __m256i exponent = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+        const __m256i n = _mm256_min_epu32(
+            _mm256_sub_epi32(_mm256_set1_epi32(158), exponent), _mm256_set1_epi32(32));
+        return _mm256_andnot_si256(_mm256_srai_epi32(a, 31), n);
+    }
+
+    static __m256i popcount(__m256i a) noexcept
+    {
+        // Nibble lookup table, then the byte counts summed into the top byte of each lane.
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0,
+            1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_and_si256(a, nibble_mask);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble_mask);
+        const __m256i bytes =
+            _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+        return _mm256_srli_epi32(_mm256_mullo_epi32(bytes, _mm256_set1_epi32(0x01010101)), 24);
+    }
+};
+}  // namespace
+
+void rounds_avx2(const epoch_context& context, mix_soa& mix, const round_program& program,
+    lookup_fn lookup) noexcept
+{
+    rounds<vec_avx2>(context, mix, program, lookup);
+}
+}  // namespace progpow
@@ -0,0 +1,99 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+// This file must be compiled with AVX-512F, AVX-512CD and AVX-512BW enabled.
+// The caller checks the CPU supports them.
+
+#include "progpow_rounds.hpp"
+
+#include <immintrin.h>
+
+namespace progpow
+{
+namespace
+{
+/// All the 16 lanes in one 512-bit vector.
+struct vec_avx512
+{
+    __m512i v;
+
+    static vec_avx512 load(const uint32_t* p) noexcept { return {_mm512_loadu_si512(p)}; }
+    static void store(uint32_t* p, vec_avx512 a) noexcept { _mm512_storeu_si512(p, a.v); }
+    static vec_avx512 set1(uint32_t x) noexcept { return {_mm512_set1_epi32(int(x))}; }
+
+    static vec_avx512 lane_ids() noexcept
+    {
+        return {_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)};
+    }
+
+    static vec_avx512 gather(const uint32_t* base, vec_avx512 indexes) noexcept
+    {
+        return {_mm512_i32gather_epi32(indexes.v, base, 4)};
+    }
+
+    static vec_avx512 add(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_add_epi32(a.v, b.v)};
+    }
+    static vec_avx512 mul(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_mullo_epi32(a.v, b.v)};
+    }
+    static vec_avx512 min(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_min_epu32(a.v, b.v)};
+    }
+    static vec_avx512 rotl(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_rolv_epi32(a.v, b.v)};
+    }
+    static vec_avx512 rotr(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_rorv_epi32(a.v, b.v)};
+    }
+    static vec_avx512 and_(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_and_si512(a.v, b.v)};
+    }
+    static vec_avx512 or_(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_or_si512(a.v, b.v)};
+    }
+    static vec_avx512 xor_(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        return {_mm512_xor_si512(a.v, b.v)};
+    }
+
+    static vec_avx512 mul_hi(vec_avx512 a, vec_avx512 b) noexcept
+    {
+        // The high halves of the 64-bit products of the even and the odd lanes.
+        const __m512i even = _mm512_srli_epi64(_mm512_mul_epu32(a.v, b.v), 32);
+        const __m512i odd =
+            _mm512_mul_epu32(_mm512_srli_epi64(a.v, 32), _mm512_srli_epi64(b.v, 32));
+        return {_mm512_mask_blend_epi32(0xAAAA, even, odd)};
+    }
+
+    static vec_avx512 clz(vec_avx512 a) noexcept { return {_mm512_lzcnt_epi32(a.v)}; }
+
+    static vec_avx512 popcount(vec_avx512 a) noexcept
+    {
+        // Nibble lookup table, then the byte counts summed into the top byte of each lane.
+        const __m512i lut = _mm512_broadcast_i32x4(
+            _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+        const __m512i nibble_mask = _mm512_set1_epi8(0x0f);
+        const __m512i lo = _mm512_and_si512(a.v, nibble_mask);
+        const __m512i hi = _mm512_and_si512(_mm512_srli_epi16(a.v, 4), nibble_mask);
+        const __m512i bytes =
+            _mm512_add_epi8(_mm512_shuffle_epi8(lut, lo), _mm512_shuffle_epi8(lut, hi));
+        return {_mm512_srli_epi32(_mm512_mullo_epi32(bytes, _mm512_set1_epi32(0x01010101)), 24)};
+    }
+};
+}  // namespace
+
+void rounds_avx512(const epoch_context& context, mix_soa& mix, const round_program& program,
+    lookup_fn lookup) noexcept
+{
+    rounds<vec_avx512>(context, mix, program, lookup);
+}
+}  // namespace progpow
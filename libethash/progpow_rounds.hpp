@@ -0,0 +1,135 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0. See the LICENSE file.
+
+/// @file
+/// The ProgPoW round engine operating on all the lanes at once.
+///
+/// This is the portable round() from progpow.cpp rewritten for the structure-of-arrays mix.
+/// The selectors are the same in every lane, so the operation is chosen once for all the lanes.
+/// The engine is a template over the vector type V holding the same register of all the lanes
+/// and is instantiated in the per-ISA source files. V must provide:
+///
+///     static V load(const uint32_t* p);            static void store(uint32_t* p, V a);
+///     static V set1(uint32_t x);                   static V lane_ids();  // 0, 1, ..., 15
+///     static V gather(const uint32_t* base, V indexes);
+///     add, mul, mul_hi, min, rotl, rotr, and_, or_, xor_: lane-wise binary operations
+///     clz, popcount: lane-wise unary operations
+///
+/// Everything here has internal linkage so the code built for different ISA extensions
+/// is never merged by the linker.
+
+#pragma once
+
+#include "progpow-internal.hpp"
+
+namespace progpow
+{
+namespace
+{
+template <typename V>
+inline V random_math(V a, V b, uint32_t selector) noexcept
+{
+    switch (selector % 11)
+    {
+    default:
+    case 0:
+        return V::add(a, b);
+    case 1:
+        return V::mul(a, b);
+    case 2:
+        return V::mul_hi(a, b);
+    case 3:
+        return V::min(a, b);
+    case 4:
+        return V::rotl(a, b);
+    case 5:
+        return V::rotr(a, b);
+    case 6:
+        return V::and_(a, b);
+    case 7:
+        return V::or_(a, b);
+    case 8:
+        return V::xor_(a, b);
+    case 9:
+        return V::add(V::clz(a), V::clz(b));
+    case 10:
+        return V::add(V::popcount(a), V::popcount(b));
+    }
+}
+
+template <typename V>
+inline V random_merge(V a, V b, uint32_t selector) noexcept
+{
+    const auto x = (selector >> 16) % 31 + 1;
+    switch (selector % 4)
+    {
+    default:
+    case 0:
+        return V::add(V::mul(a, V::set1(33)), b);
+    case 1:
+        return V::mul(V::xor_(a, b), V::set1(33));
+    case 2:
+        return V::xor_(V::rotl(a, V::set1(x)), b);
+    case 3:
+        return V::xor_(V::rotr(a, V::set1(x)), b);
+    }
+}
+
+template <typename V>
+inline void rounds(const epoch_context& context, mix_soa& mix, const round_program& program,
+    lookup_fn lookup) noexcept
+{
+    static_assert((l1_cache_num_items & (l1_cache_num_items - 1)) == 0,
+        "l1_cache_num_items must be a power of 2");
+
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+    const V l1_mask = V::set1(l1_cache_num_items - 1);
+    const V lane_ids = V::lane_ids();
+
+    V regs[num_regs];
+    for (uint32_t i = 0; i < num_regs; ++i)
+        regs[i] = V::load(mix[i]);
+
+    for (uint32_t r = 0; r < 64; ++r)
+    {
+        uint32_t reg0[num_lanes];
+        V::store(reg0, regs[0]);
+        const uint32_t item_index = reg0[r % num_lanes] % num_items;
+        const hash2048 item = lookup(context, item_index);
+
+        for (int i = 0; i < max_operations; ++i)
+        {
+            if (i < num_cache_accesses)
+            {
+                const auto& op = program.cache_accesses[i];
+                const V offsets = V::and_(regs[op.src], l1_mask);
+                const V data = V::gather(context.l1_cache, offsets);
+                regs[op.dst] = random_merge(regs[op.dst], data, op.sel);
+            }
+            if (i < num_math_operations)
+            {
+                const auto& op = program.math_operations[i];
+                const V data = random_math(regs[op.src1], regs[op.src2], op.sel1);
+                regs[op.dst] = random_merge(regs[op.dst], data, op.sel2);
+            }
+        }
+
+        // The lane l merges the words from ((l ^ r) % num_lanes) * num_words_per_lane.
+        const V lane_offsets = V::mul(V::and_(V::xor_(lane_ids, V::set1(r)),
+                                          V::set1(num_lanes - 1)),
+            V::set1(num_words_per_lane));
+        for (size_t i = 0; i < num_words_per_lane; ++i)
+        {
+            const V words =
+                V::gather(item.word32s, V::add(lane_offsets, V::set1(static_cast<uint32_t>(i))));
+            regs[program.dag_dsts[i]] =
+                random_merge(regs[program.dag_dsts[i]], words, program.dag_sels[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < num_regs; ++i)
+        V::store(mix[i], regs[i]);
+}
+}  // namespace
+}  // namespace progpow
@@ -30,3 +30,10 @@
 #else
 #define NO_SANITIZE(sanitizer)
 #endif
+
+/** __builtin_prefetch() */
+#if __GNUC__ || __clang__
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr)
+#endif
@@ -48,6 +48,31 @@ Farm::Farm(std::map<std::string, DeviceDescriptor>& _DevicesCollection,
 {
     m_this = this;
 
+    // Map the light caches and DAGs generated by earlier runs instead of building them again
+    ethash::set_context_cache_directory(m_Settings.dagCache);
+
+    // Verify the solutions off the io_service, it also serves the pool connection and the API.
+    // The verified ones are submitted back on the strand.
+#ifdef DEV_BUILD
+    const bool dbuild = true;
+#else
+    const bool dbuild = false;
+#endif
+    if (!m_Settings.noEval || dbuild)
+        m_verifier.reset(new SolutionVerifier(m_Settings.verifyThreads, m_Settings.verifyQueue,
+            [this](Solution& _s) { return verifyProof(_s); },
+            [this](const Solution& _s, bool _valid) {
+                g_io_service.post(
+                    m_io_strand.wrap(boost::bind(&Farm::submitProofAsync, this, _s, _valid)));
+            }));
+
+    // Keep the contexts of the recent epochs for pools switching between them
+    ethash::epoch_cache_limits epochCache;
+    epochCache.max_light = m_Settings.epochCacheLight;
+    epochCache.max_full = m_Settings.epochCacheFull;
+    epochCache.max_bytes = uint64_t(m_Settings.epochCacheMemory) << 20;
+    ethash::set_epoch_cache_limits(epochCache);
+
     // Init HWMON if needed
     if (m_Settings.hwMon)
     {
@@ -211,6 +236,9 @@ void Farm::setWork(WorkPackage const& _newWp)
 
     m_currentWp = _newWp;
 
+    // Prebuild the next epoch's contexts when getting close to it
+    ethash::prebuild_epoch_contexts(m_currentWp.block);
+
     // Check if we need to shuffle per work (ergodicity == 2)
     if (m_Settings.ergodicity == 2 && m_currentWp.exSizeBytes == 0)
         shuffle();
@@ -294,6 +322,15 @@ bool Farm::start()
             m_miners.back()->startWorking();
         }
 
+        // Build the next epoch's contexts in the background when they fit in the memory budget,
+        // the full dataset too if CPU miners run
+        ethash::prebuild_options prebuild;
+        prebuild.memory_budget = uint64_t(m_Settings.dagPrebuild) << 20;
+        prebuild.full = std::any_of(m_telemetry.miners.begin(), m_telemetry.miners.end(),
+            [](const TelemetryAccountType& miner) { return miner.prefix == "cp"; });
+        prebuild.build.num_threads = m_CPSettings.dagThreads;
+        ethash::set_prebuild_options(prebuild);
+
         // Initialize DAG Load mode
         Miner::setDagLoadInfo(m_Settings.dagLoadMode, (unsigned int)m_miners.size());
 
@@ -482,32 +519,35 @@ void Farm::setTStartTStop(unsigned tstart, unsigned tstop)
 
 void Farm::submitProof(Solution const& _s)
 {
-    g_io_service.post(m_io_strand.wrap(boost::bind(&Farm::submitProofAsync, this, _s)));
+    if (m_verifier)
+        m_verifier->submit(_s);
+    else
+        g_io_service.post(m_io_strand.wrap(boost::bind(&Farm::submitProofAsync, this, _s, true)));
 }
 
-void Farm::submitProofAsync(Solution const& _s)
+bool Farm::verifyProof(Solution& _s)
 {
+    Result r = EthashAux::eval(_s.work.epoch, _s.work.block, _s.work.header, _s.nonce);
+    if (r.value > _s.work.boundary)
+        return false;
 #ifdef DEV_BUILD
-    const bool dbuild = true;
-#else
-    const bool dbuild = false;
+    if (_s.mixHash != r.mixHash)
+        cwarn << "GPU " << _s.midx << " mix missmatch";
 #endif
-    if (!m_Settings.noEval || dbuild)
+    _s.mixHash = r.mixHash;
+    return true;
+}
+
+void Farm::submitProofAsync(Solution const& _s, bool _valid)
+{
+    if (!_valid)
     {
-        Result r = EthashAux::eval(_s.work.epoch, _s.work.block, _s.work.header, _s.nonce);
-        if (r.value > _s.work.boundary)
-        {
-            accountSolution(_s.midx, SolutionAccountingEnum::Failed);
-            cwarn << "GPU " << _s.midx
-                  << " gave incorrect result. Lower overclocking values if it happens frequently.";
-            return;
-        }
-        if (dbuild && (_s.mixHash != r.mixHash))
-            cwarn << "GPU " << _s.midx << " mix missmatch";
-        m_onSolutionFound(Solution{_s.nonce, r.mixHash, _s.work, _s.tstamp, _s.midx});
+        accountSolution(_s.midx, SolutionAccountingEnum::Failed);
+        cwarn << "GPU " << _s.midx
+              << " gave incorrect result. Lower overclocking values if it happens frequently.";
+        return;
     }
-    else
-        m_onSolutionFound(_s);
+    m_onSolutionFound(_s);
 
 #ifdef DEV_BUILD
     if (g_logOptions & LOG_SUBMIT)
@@ -519,6 +559,11 @@ void Farm::submitProofAsync(Solution const& _s)
 #endif
 }
 
+VerifierStats Farm::getVerifierStats()
+{
+    return m_verifier ? m_verifier->stats() : VerifierStats();
+}
+
 // Collects data about hashing and hardware status
 void Farm::collectData(const boost::system::error_code& ec)
 {
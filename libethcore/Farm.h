@@ -33,6 +33,7 @@
 #include <libdevcore/Worker.h>
 
 #include <libethcore/Miner.h>
+#include <libethcore/SolutionVerifier.h>
 
 #include <libhwmon/wrapnvml.h>
 #if defined(__linux)
@@ -56,6 +57,13 @@ struct FarmSettings
     unsigned ergodicity = 0;   // 0=default, 1=per session, 2=per job
     unsigned tempStart = 40;   // Temperature threshold to restart mining (if paused)
     unsigned tempStop = 0;     // Temperature threshold to pause mining (overheating)
+    std::string dagCache;      // Directory of the on-disk light cache and DAG files (empty = off)
+    unsigned dagPrebuild = 1024;  // MB the current and next epoch contexts may take (0 = off)
+    unsigned epochCacheLight = 3;  // Light contexts kept for switching epochs
+    unsigned epochCacheFull = 1;   // Contexts with full dataset kept, per NUMA node
+    unsigned epochCacheMemory = 0; // MB the kept contexts may take (0 = no limit)
+    unsigned verifyThreads = 2;    // Threads verifying the solutions
+    unsigned verifyQueue = 64;     // Solutions waiting for verification at most
 };
 
 /**
@@ -245,12 +253,20 @@ public:
 
     bool getNoEval() { return m_Settings.noEval; }
 
+    /**
+     * @brief Gets the queue depth and latency of the solution verification
+     */
+    VerifierStats getVerifierStats();
+
 private:
     std::atomic<bool> m_paused = {false};
 
-    // Async submits solution serializing execution
+    // Verifies solution on the verifier threads
+    bool verifyProof(Solution& _s);
+
+    // Async submits verified solution serializing execution
     // in Farm's strand
-    void submitProofAsync(Solution const& _s);
+    void submitProofAsync(Solution const& _s, bool _valid);
 
     // Collects data about hashing and hardware status
     void collectData(const boost::system::error_code& ec);
@@ -311,6 +327,9 @@ private:
 #if DEV_BUILD
     uint32_t m_period = 0;
 #endif
+
+    // Last so that its threads stop first
+    std::unique_ptr<SolutionVerifier> m_verifier;
 };
 
 }  // namespace eth
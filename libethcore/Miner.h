@@ -119,6 +119,8 @@ struct CLSettings : public MinerSettings
 // Holds settings for CPU Miner
 struct CPSettings : public MinerSettings
 {
+    unsigned dagThreads = 0;  // Threads generating the DAG on epoch change (0 = all CPUs)
+    unsigned hugePages = 3;   // Largest pages tried for the DAG (0 = normal .. 3 = 1 GB)
 };
 
 struct SolutionAccountType
@@ -203,6 +205,7 @@ struct DeviceDescriptor
     unsigned int cuComputeMinor;
 
     int cpCpuNumer;   // For CPU
+    unsigned cpNumaNode;
 };
 
 struct HwMonitorInfo
@@ -0,0 +1,125 @@
+/*
+    This file is part of ethcoreminer.
+
+    ethcoreminer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ethcoreminer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ethcoreminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SolutionVerifier.h"
+
+#include <algorithm>
+
+using namespace dev;
+using namespace eth;
+
+constexpr unsigned VerifierStats::bucketBounds[];
+
+SolutionVerifier::SolutionVerifier(
+    unsigned _threads, unsigned _queueSize, Check _check, Verified _verified)
+  : m_check(std::move(_check)),
+    m_verified(std::move(_verified)),
+    m_queueSize(std::max(_queueSize, 1u))
+{
+    for (unsigned i = 0; i < std::max(_threads, 1u); i++)
+        m_threads.emplace_back(&SolutionVerifier::workLoop, this);
+}
+
+SolutionVerifier::~SolutionVerifier()
+{
+    {
+        std::lock_guard<std::mutex> l(x_queue);
+        m_stop = true;
+    }
+    m_queueSignal.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void SolutionVerifier::submit(Solution const& _s)
+{
+    auto p = std::make_shared<Pending>();
+    p->solution = _s;
+    p->submitted = std::chrono::steady_clock::now();
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> l(x_queue);
+        m_jobs[_s.work.job].push_back(p);
+        m_stats.queueDepth++;
+        m_stats.maxQueueDepth = std::max(m_stats.maxQueueDepth, m_stats.queueDepth);
+
+        full = m_queue.size() >= m_queueSize;
+        if (full)
+            m_stats.inlined++;
+        else
+            m_queue.push_back(p);
+    }
+
+    // Slow down the submitter rather than let the queue grow
+    if (full)
+        verify(p);
+    else
+        m_queueSignal.notify_one();
+}
+
+VerifierStats SolutionVerifier::stats() const
+{
+    std::lock_guard<std::mutex> l(x_queue);
+    return m_stats;
+}
+
+void SolutionVerifier::workLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<Pending> p;
+        {
+            std::unique_lock<std::mutex> l(x_queue);
+            m_queueSignal.wait(l, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop)
+                return;
+            p = m_queue.front();
+            m_queue.pop_front();
+        }
+        verify(p);
+    }
+}
+
+void SolutionVerifier::verify(std::shared_ptr<Pending> _p)
+{
+    _p->valid = m_check(_p->solution);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - _p->submitted);
+    auto bucket = std::upper_bound(std::begin(VerifierStats::bucketBounds),
+                      std::end(VerifierStats::bucketBounds), unsigned(elapsed.count())) -
+                  std::begin(VerifierStats::bucketBounds);
+
+    std::lock_guard<std::mutex> l(x_queue);
+    _p->done = true;
+    m_stats.verified++;
+    m_stats.latency[bucket]++;
+
+    // Hand over the verified solutions at the head of the job, the ones submitted
+    // after them wait for them
+    auto job = m_jobs.find(_p->solution.work.job);
+    auto& pending = job->second;
+    while (!pending.empty() && pending.front()->done)
+    {
+        m_verified(pending.front()->solution, pending.front()->valid);
+        pending.pop_front();
+        m_stats.queueDepth--;
+    }
+    if (pending.empty())
+        m_jobs.erase(job);
+}
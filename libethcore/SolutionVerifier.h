@@ -0,0 +1,102 @@
+/*
+    This file is part of ethcoreminer.
+
+    ethcoreminer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ethcoreminer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ethcoreminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libethcore/EthashAux.h>
+
+namespace dev
+{
+namespace eth
+{
+struct VerifierStats
+{
+    // Latency buckets are below these ms, the last bucket holds the rest
+    static constexpr unsigned bucketBounds[] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+    static constexpr size_t numBuckets = sizeof(bucketBounds) / sizeof(bucketBounds[0]) + 1;
+
+    unsigned queueDepth = 0;     // Solutions waiting or being verified
+    unsigned maxQueueDepth = 0;  // Highest queue depth seen
+    uint64_t verified = 0;       // Solutions verified
+    uint64_t inlined = 0;        // Solutions verified by the submitter as the queue was full
+    std::array<uint64_t, numBuckets> latency{};  // From submission to verified
+};
+
+/**
+ * @brief Verifies solutions on a pool of threads.
+ * Verification is a light mode hash, which would otherwise hold the io_service serving the
+ * pool connection and the API. The verified solutions are handed over in submission order
+ * within each job.
+ * @threadsafe
+ */
+class SolutionVerifier
+{
+public:
+    // Verifies the solution, completing it with the computed mix hash. False if invalid.
+    using Check = std::function<bool(Solution&)>;
+    using Verified = std::function<void(const Solution&, bool)>;
+
+    /**
+     * @param _threads  Number of verifying threads
+     * @param _queueSize  Solutions queued at most. Beyond, the submitter verifies itself
+     * @param _verified  Called with the verified solutions, in submission order within a job
+     */
+    SolutionVerifier(unsigned _threads, unsigned _queueSize, Check _check, Verified _verified);
+    ~SolutionVerifier();
+
+    void submit(Solution const& _s);
+
+    VerifierStats stats() const;
+
+private:
+    struct Pending
+    {
+        Solution solution;
+        std::chrono::steady_clock::time_point submitted;
+        bool valid = false;
+        bool done = false;
+    };
+
+    void workLoop();
+    void verify(std::shared_ptr<Pending> _p);
+
+    Check m_check;
+    Verified m_verified;
+    unsigned m_queueSize;
+
+    mutable std::mutex x_queue;
+    std::condition_variable m_queueSignal;
+    std::deque<std::shared_ptr<Pending>> m_queue;                         // Waiting for a thread
+    std::map<std::string, std::deque<std::shared_ptr<Pending>>> m_jobs;  // In submission order
+    VerifierStats m_stats;
+    bool m_stop = false;
+
+    std::vector<std::thread> m_threads;
+};
+
+}  // namespace eth
+}  // namespace dev
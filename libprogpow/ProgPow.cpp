@@ -74,6 +74,28 @@ std::string ProgPow::getKern(std::string kernel_code, uint64_t prog_seed, kernel
 
         ret << "\n";
     }
+    else if (kern == KERNEL_CPU)
+    {
+        // The registers hold all the lanes: lanes_t is a GCC/Clang vector of PROGPOW_LANES words
+        ret << "#include <stdint.h>\n";
+        ret << "typedef uint32_t lanes_t __attribute__((vector_size(" << PROGPOW_LANES * 4
+            << ")));\n";
+        ret << "#define ROTL32(x, n) (((x) << ((n) % 32)) | ((x) >> ((32 - (n) % 32) % 32)))\n";
+        ret << "#define ROTR32(x, n) (((x) >> ((n) % 32)) | ((x) << ((32 - (n) % 32) % 32)))\n";
+        ret << "#define LANEWISE(f, ...) ({ lanes_t r_; for (int l_ = 0; l_ < " << PROGPOW_LANES
+            << "; l_++) r_[l_] = f(l_, __VA_ARGS__); r_; })\n";
+        ret << "#define MIN_(l, a, b) ((a)[l] < (b)[l] ? (a)[l] : (b)[l])\n";
+        ret << "#define MUL_HI_(l, a, b) ((uint32_t)(((uint64_t)(a)[l] * (b)[l]) >> 32))\n";
+        ret << "#define CLZ_(l, a) ((a)[l] ? (uint32_t)__builtin_clz((a)[l]) : 32u)\n";
+        ret << "#define POPCOUNT_(l, a) ((uint32_t)__builtin_popcount((a)[l]))\n";
+        ret << "#define CACHE_(l, a) c_dag[(a)[l] % PROGPOW_CACHE_WORDS]\n";
+        ret << "#define min(a, b) LANEWISE(MIN_, a, b)\n";
+        ret << "#define mul_hi(a, b) LANEWISE(MUL_HI_, a, b)\n";
+        ret << "#define clz(a) LANEWISE(CLZ_, a)\n";
+        ret << "#define popcount(a) LANEWISE(POPCOUNT_, a)\n";
+        ret << "#define cache_load(a) LANEWISE(CACHE_, a)\n";
+        ret << "\n";
+    }
     else
     {
         ret << "#ifndef GROUP_SIZE\n";
@@ -101,6 +123,11 @@ std::string ProgPow::getKern(std::string kernel_code, uint64_t prog_seed, kernel
         ret << "typedef struct __align__(16) {uint32_t s[PROGPOW_DAG_LOADS];} dag_t;\n";
         ret << "\n";
     }
+    else if (kern == KERNEL_CPU)
+    {
+        ret << "typedef struct {lanes_t s[PROGPOW_DAG_LOADS];} dag_t;\n";
+        ret << "\n";
+    }
     else
     {
         ret << "typedef struct __attribute__ ((aligned (16))) {uint32_t s[PROGPOW_DAG_LOADS];} dag_t;\n";
@@ -109,31 +136,43 @@ std::string ProgPow::getKern(std::string kernel_code, uint64_t prog_seed, kernel
     std::string kernel = std::regex_replace(kernel_code, std::regex("PROGPOW_REPLACE_HEADER"), ret.str());
     ret.str(std::string());
 
-    ret << "uint32_t offset, data;\n";
+    if (kern == KERNEL_CPU)
+        ret << "lanes_t data;\n";
+    else
+        ret << "uint32_t offset, data;\n";
 
     // Global memory access
     // lanes access sequential locations
     // Hard code mix[0] to guarantee the address for the global load depends on the result of the
     // load
     ret << "// global load\n";
-    if (kern == KERNEL_CUDA)
-        ret << "offset = SHFL(mix[0], loop % PROGPOW_LANES, PROGPOW_LANES);\n";
-    else
+    if (kern == KERNEL_CPU)
     {
-        ret << "if(lane_id == (loop % PROGPOW_LANES))\n";
-        ret << "    share[0].uint32s[group_id] = mix[0];\n";
-        ret << "barrier(CLK_LOCAL_MEM_FENCE);\n";
-        ret << "offset = share[0].uint32s[group_id];\n";
+        // The host loads the words of the item addressed by mix[0] of the lane
+        // (loop % PROGPOW_LANES) into data_dag
+        ret << "// data_dag loaded by the caller\n";
     }
-    ret << "offset %= PROGPOW_DAG_ELEMENTS;\n";
-    ret << "offset = offset * PROGPOW_LANES + (lane_id ^ loop) % PROGPOW_LANES;\n";
-    ret << "dag_t data_dag = g_dag[offset];\n";
-
-    ret << "// hack to prevent compiler from reordering LD and usage\n";
-    if (kern == KERNEL_CUDA)
-        ret << "if (hack_false) __threadfence_block();\n";
     else
-        ret << "if (hack_false) barrier(CLK_LOCAL_MEM_FENCE);\n";
+    {
+        if (kern == KERNEL_CUDA)
+            ret << "offset = SHFL(mix[0], loop % PROGPOW_LANES, PROGPOW_LANES);\n";
+        else
+        {
+            ret << "if(lane_id == (loop % PROGPOW_LANES))\n";
+            ret << "    share[0].uint32s[group_id] = mix[0];\n";
+            ret << "barrier(CLK_LOCAL_MEM_FENCE);\n";
+            ret << "offset = share[0].uint32s[group_id];\n";
+        }
+        ret << "offset %= PROGPOW_DAG_ELEMENTS;\n";
+        ret << "offset = offset * PROGPOW_LANES + (lane_id ^ loop) % PROGPOW_LANES;\n";
+        ret << "dag_t data_dag = g_dag[offset];\n";
+
+        ret << "// hack to prevent compiler from reordering LD and usage\n";
+        if (kern == KERNEL_CUDA)
+            ret << "if (hack_false) __threadfence_block();\n";
+        else
+            ret << "if (hack_false) barrier(CLK_LOCAL_MEM_FENCE);\n";
+    }
 
     for (uint32_t i = 0; (i < PROGPOW_CNT_CACHE) || (i < PROGPOW_CNT_MATH); i++)
     {
@@ -145,8 +184,13 @@ std::string ProgPow::getKern(std::string kernel_code, uint64_t prog_seed, kernel
             std::string dest = mix_dst();
             uint32_t r = rnd();
             ret << "// cache load " << i << "\n";
-            ret << "offset = " << src << " % PROGPOW_CACHE_WORDS;\n";
-            ret << "data = c_dag[offset];\n";
+            if (kern == KERNEL_CPU)
+                ret << "data = cache_load(" << src << ");\n";
+            else
+            {
+                ret << "offset = " << src << " % PROGPOW_CACHE_WORDS;\n";
+                ret << "data = c_dag[offset];\n";
+            }
             ret << merge(dest, "data", r);
         }
         if (i < PROGPOW_CNT_MATH)
@@ -169,11 +213,14 @@ std::string ProgPow::getKern(std::string kernel_code, uint64_t prog_seed, kernel
     }
     // Consume the global load data at the very end of the loop, to allow fully latency hiding
     ret << "// consume global load data\n";
-    ret << "// hack to prevent compiler from reordering LD and usage\n";
-    if (kern == KERNEL_CUDA)
-        ret << "if (hack_false) __threadfence_block();\n";
-    else
-        ret << "if (hack_false) barrier(CLK_LOCAL_MEM_FENCE);\n";
+    if (kern != KERNEL_CPU)
+    {
+        ret << "// hack to prevent compiler from reordering LD and usage\n";
+        if (kern == KERNEL_CUDA)
+            ret << "if (hack_false) __threadfence_block();\n";
+        else
+            ret << "if (hack_false) barrier(CLK_LOCAL_MEM_FENCE);\n";
+    }
     ret << merge("mix[0]", "data_dag.s[0]", rnd());
     for (uint32_t i = 1; i < PROGPOW_DAG_LOADS; i++)
     {
@@ -26,7 +26,8 @@ public:
     typedef enum
     {
         KERNEL_CUDA,
-        KERNEL_CL
+        KERNEL_CL,
+        KERNEL_CPU
     } kernel_t;
 
 